@@ -27,11 +27,18 @@
  * @author Maurice Bleuel
  */
 
+#define _POSIX_C_SOURCE 200112L
+
+#include <limits.h>
 #include <stdio.h>
 #include <malloc.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "constants.h"
 #include "simpleicon.h"
 
@@ -46,7 +53,7 @@ SimpleIcon *SimpleIcon_create(const char *file)
         return 0;
     }
 
-    SimpleIcon *_si = malloc(sizeof(SimpleIcon));
+    SimpleIcon *_si = calloc(1, sizeof(SimpleIcon));
     SimpleIcon_loadFromFile(_si, f);
 
     fclose(f);
@@ -56,141 +63,301 @@ SimpleIcon *SimpleIcon_create(const char *file)
 void SimpleIcon_destroy(SimpleIcon *_si)
 {
     free(_si->name);
-    for (int i = 0; i < _si->height; ++i) {
-        free(_si->data[i]);
-        _si->data[i] = 0;
-    }
     free(_si->data);
     free(_si);
-
-    _si->name = 0;
-    _si->data = 0;
-    _si = 0;
 }
 
 int SimpleIcon_loadFromFile(SimpleIcon *_si, FILE *file)
 {
-    char *file_content = malloc(sizeof(char) * 2048);
-    for (int i = 0; i < 2048; ++i) {
-        file_content[i] = '\0';
+    struct stat st;
+    char *file_content = 0;
+    size_t length = 0;
+    int mapped = FALSE;
+    int fd = fileno(file);
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        length = (size_t) st.st_size;
+        file_content = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (file_content == MAP_FAILED) {
+            file_content = 0;
+        } else {
+            posix_madvise(file_content, length, POSIX_MADV_SEQUENTIAL);
+            mapped = TRUE;
+        }
     }
-    fgets(file_content, 2048, file);
-    SimpleIcon_parseHeader(_si, file_content);
 
-    free(file_content);
-    return TRUE;
+    // Not mappable (e.g. a pipe): read everything into a growing buffer
+    if (!mapped) {
+        size_t capacity = 0;
+        size_t count;
+        length = 0;
+        do {
+            if (length == capacity) {
+                capacity = capacity ? capacity * 2 : 4096;
+                char *grown = realloc(file_content, capacity);
+                if (!grown) {
+                    free(file_content);
+                    return FALSE;
+                }
+                file_content = grown;
+            }
+            count = fread(file_content + length, 1, capacity - length, file);
+            length += count;
+        } while (count > 0);
+    }
+
+    while (length > 0 && (file_content[length - 1] == '\n'
+                          || file_content[length - 1] == '\r')) {
+        --length;
+    }
+    int retval = SimpleIcon_parseHeader(_si, file_content, length);
+
+    if (mapped) {
+        munmap(file_content, (size_t) st.st_size);
+    } else {
+        free(file_content);
+    }
+    return retval == SI_NO_ERROR ? TRUE : FALSE;
 }
 
 void SimpleIcon_display(SimpleIcon *_si)
 {
-    printf("%s (%dx%d)\nVersion: %d\n",
-           _si->name, _si->width, _si->height, _si->file_version);
+    char *frame = 0;
+    size_t capacity = 0;
+    size_t length = SimpleIcon_render(_si, &frame, &capacity);
+
+    fwrite(frame, 1, length, stdout);
+    fflush(stdout);
+    free(frame);
+}
+
+size_t SimpleIcon_render(const SimpleIcon *_si, char **buffer, size_t *capacity)
+{
+    // "ascii art" for every possible run of 8 pixels
+    static char table[256][8];
+    static int tableReady = FALSE;
+    if (!tableReady) {
+        for (int byte = 0; byte < 256; ++byte) {
+            for (int bit = 0; bit < 8; ++bit) {
+                table[byte][bit] = ((byte >> bit) & 1) ? 'x' : ' ';
+            }
+        }
+        tableReady = TRUE;
+    }
+
+    const char *format = "%s (%dx%d)\nVersion: %d\n";
+    int headerLength = snprintf(0, 0, format, _si->name, _si->width,
+                                _si->height, _si->file_version);
+    int width = _si->data ? _si->width : 0;
+    int height = _si->data ? _si->height : 0;
+    size_t lineLength = (size_t) width + 1;
+    size_t length = (size_t) headerLength + lineLength * height;
+
+    if (*capacity < length + 1) {
+        char *grown = realloc(*buffer, length + 1);
+        if (!grown) {
+            return 0;
+        }
+        *buffer = grown;
+        *capacity = length + 1;
+    }
+
+    snprintf(*buffer, headerLength + 1, format, _si->name, _si->width,
+             _si->height, _si->file_version);
+    char *dst = *buffer + headerLength;
 
-    for (int col = 0; col < _si->height; ++col) {
-        for (int row = 0; row < _si->width; ++row) {
-            char out = (_si->data[col][row] == '1') ? 'x' : ' ';
-            printf("%c", out);
+    for (int row = 0; row < height; ++row) {
+        const unsigned char *bytes = (const unsigned char *) (_si->data + row * _si->stride);
+        int col = 0;
+        for (; col + 8 <= width; col += 8) {
+            memcpy(dst + col, table[bytes[col >> 3]], 8);
         }
-        printf("\n");
+        if (col < width) {
+            memcpy(dst + col, table[bytes[col >> 3]], width - col);
+        }
+        dst[width] = '\n';
+        dst += lineLength;
     }
+    *dst = '\0';
+
+    return length;
 }
 
-int SimpleIcon_parseHeader(SimpleIcon *_si, const char *file_data)
+/**
+ * Find the next SI_DELIM in [begin, end).
+ * @return Pointer to the delimiter or 0 if there is none
+ */
+static const char *SimpleIcon_findDelim(const char *begin, const char *end)
 {
-    char *text = malloc(sizeof(char) * (strlen(file_data) + 1));
-    strncpy(text, file_data, strlen(file_data) + 1);
-    int pos = SI_POS_NAME;
-
-    char *buf;
-    char *versionbuf;
-    char *file_content;
-    buf = strtok(text, SI_DELIM);
-    while (buf) {
-        switch (pos) {
-        case SI_POS_NAME:
-            _si->name = malloc(sizeof(char) * strlen(buf) + 1);
-            strncpy(_si->name, buf, strlen(buf) + 1);
-            pos = SI_POS_VERSION;
-            break;
-        case SI_POS_VERSION:
-            _si->file_version = atoi(buf);
-            pos = SI_POS_SIZE;
-            break;
-        case SI_POS_SIZE:
-            versionbuf = buf;
-            pos = SI_POS_DATA;
-            break;
-        case SI_POS_DATA:
-            file_content = malloc(sizeof(char) * strlen(buf));
-            strcpy(file_content, buf);
-            break;
+    const char *pos = begin;
+    while (pos < end && (pos = memchr(pos, SI_DELIM[0], end - pos))) {
+        if (pos + 1 < end && pos[1] == SI_DELIM[1]) {
+            return pos;
         }
+        ++pos;
+    }
+    return 0;
+}
 
-        buf = strtok(0, SI_DELIM);
+/**
+ * Parse a positive decimal number in [*pos, end), skipping blanks around
+ * it. Signs, overflow and zero are rejected.
+ * @return TRUE on success; *pos then points behind the number
+ */
+static int SimpleIcon_parsePositive(const char **pos, const char *end, int *value)
+{
+    const char *p = *pos;
+    long parsed = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    if (p == end || *p < '0' || *p > '9') {
+        return FALSE;
     }
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        parsed = parsed * 10 + (*p - '0');
+        if (parsed > INT_MAX) {
+            return FALSE;
+        }
+    }
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    if (parsed == 0) {
+        return FALSE;
+    }
+
+    *value = (int) parsed;
+    *pos = p;
+    return TRUE;
+}
 
-    // Parse version text
-    _si->width = atoi(strtok(versionbuf, "x"));
-    _si->height = atoi(versionbuf);
+int SimpleIcon_parseHeader(SimpleIcon *_si, const char *file_data,
+                           size_t length)
+{
+    const char *fields[SI_POS_DATA + 1];
+    size_t lengths[SI_POS_DATA + 1];
+    const char *pos = file_data;
+    const char *end = file_data + length;
+
+    for (int i = SI_POS_NAME; i < SI_POS_DATA; ++i) {
+        const char *delim = SimpleIcon_findDelim(pos, end);
+        if (!delim) {
+            return SI_ILLEGAL_INPUT_FORMAT;
+        }
+        fields[i] = pos;
+        lengths[i] = delim - pos;
+        pos = delim + strlen(SI_DELIM);
+    }
+    fields[SI_POS_DATA] = pos;
+    lengths[SI_POS_DATA] = end - pos;
+
+    free(_si->name);
+    _si->name = malloc(sizeof(char) * (lengths[SI_POS_NAME] + 1));
+    memcpy(_si->name, fields[SI_POS_NAME], lengths[SI_POS_NAME]);
+    _si->name[lengths[SI_POS_NAME]] = '\0';
+
+    // Parse version and size in place
+    const char *number = fields[SI_POS_VERSION];
+    const char *numberEnd = number + lengths[SI_POS_VERSION];
+    if (!SimpleIcon_parsePositive(&number, numberEnd, &_si->file_version) ||
+            number != numberEnd) {
+        return SI_ILLEGAL_INPUT_FORMAT;
+    }
+
+    number = fields[SI_POS_SIZE];
+    numberEnd = number + lengths[SI_POS_SIZE];
+    if (!SimpleIcon_parsePositive(&number, numberEnd, &_si->width) ||
+            number == numberEnd || *number++ != 'x' ||
+            !SimpleIcon_parsePositive(&number, numberEnd, &_si->height) ||
+            number != numberEnd) {
+        return SI_ILLEGAL_INPUT_FORMAT;
+    }
 
     // Parse data
     int retval = SI_NO_ERROR;
     switch (_si->file_version) {
     case 1:
-        SimpleIcon_parseData(_si, file_content);
+        SimpleIcon_parseData(_si, fields[SI_POS_DATA], lengths[SI_POS_DATA]);
         break;
     case 2:
-        SimpleIcon_parseDataV2(_si, file_content);
+        SimpleIcon_parseDataV2(_si, fields[SI_POS_DATA], lengths[SI_POS_DATA]);
         break;
     default:
         retval = SI_ILLEGAL_INPUT_FORMAT;
     }
 
-    // Cleanup
-    free(buf);
-    free(text);
-    free(file_content);
-
     return retval;
 }
 
-void SimpleIcon_parseData(SimpleIcon *_si, const char *fileData)
+int SimpleIcon_pixel(const SimpleIcon *_si, int x, int y)
 {
-    int offset = 0;
-    char **data;
-    data = malloc(sizeof(char *) * _si->height);
-    for (int i = 0; i < _si->height; ++i) {
-        data[i] = malloc(sizeof(char) * _si->width);
+    return (_si->data[y * _si->stride + (x >> 6)] >> (x & 63)) & 1;
+}
+
+int SimpleIcon_allocData(SimpleIcon *_si)
+{
+    free(_si->data);
+    _si->data = 0;
+    _si->stride = 0;
+
+    if (_si->width <= 0 || _si->height <= 0) {
+        return FALSE;
     }
 
-    for (int col = 0; col < _si->height; ++col) {
-        for (int row = 0; row < _si->width; ++row) {
-            data[col][row] = fileData[offset++];
-        }
+    int stride = (_si->width + 63) / 64;
+    size_t bytes = sizeof(uint64_t) * stride * _si->height;
+    bytes = (bytes + SI_ALIGNMENT - 1) & ~((size_t) SI_ALIGNMENT - 1);
+
+    void *block = 0;
+    if (posix_memalign(&block, SI_ALIGNMENT, bytes) != 0) {
+        return FALSE;
+    }
+    memset(block, 0, bytes);
+
+    _si->data = block;
+    _si->stride = stride;
+    return TRUE;
+}
+
+void SimpleIcon_parseData(SimpleIcon *_si, const char *fileData,
+                          size_t length)
+{
+    size_t offset = 0;
+    if (!SimpleIcon_allocData(_si)) {
+        return;
     }
 
-    _si->data = data;
+    for (int row = 0; row < _si->height; ++row) {
+        uint64_t *bits = _si->data + row * _si->stride;
+        for (int col = 0; col < _si->width && offset < length; ++col) {
+            if (fileData[offset++] == '1') {
+                bits[col >> 6] |= (uint64_t) 1 << (col & 63);
+            }
+        }
+    }
 }
 
-void SimpleIcon_parseDataV2(SimpleIcon *_si, const char *file_data)
+void SimpleIcon_parseDataV2(SimpleIcon *_si, const char *file_data,
+                            size_t length)
 {
-    int charPos = 0;
+    size_t charPos = 0;
     int offset = 0;
-    char **data;
-    data = malloc(sizeof(char *) * _si->height);
-    for (int i = 0; i < _si->height; ++i) {
-        data[i] = malloc(sizeof(char) * _si->width);
+    if (!SimpleIcon_allocData(_si)) {
+        return;
     }
 
     for (offset = 0; offset < _si->width; offset += 8) {
-        for (int col = 0; col < _si->height; ++col) {
-            for (int row = offset; row < offset + 8; ++row) {
-                if (row < _si->width) {
-                    data[col][row] = file_data[charPos++];
+        for (int row = 0; row < _si->height; ++row) {
+            uint64_t *bits = _si->data + row * _si->stride;
+            for (int col = offset; col < offset + 8; ++col) {
+                if (col < _si->width && charPos < length) {
+                    if (file_data[charPos++] == '1') {
+                        bits[col >> 6] |= (uint64_t) 1 << (col & 63);
+                    }
                 }
             }
         }
     }
-
-    _si->data = data;
 }
@@ -30,6 +30,10 @@
 #ifndef SIMPLEICON_H
 #define SIMPLEICON_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
 #define SI_DELIM ";;"
 
 #define SI_NO_ERROR 0
@@ -40,8 +44,16 @@
 #define SI_POS_SIZE 2
 #define SI_POS_DATA 3
 
+/** Alignment of the pixel block in bytes. */
+#define SI_ALIGNMENT 64
+
 /**
  * Data struct representing data of a SimpleIcon.
+ *
+ * Pixels are stored as one contiguous, SI_ALIGNMENT aligned bitplane with
+ * one bit per pixel. Every row starts on a 64 bit word boundary and holds
+ * pixel x in bit (x % 64) of word (x / 64); stride is the row length in
+ * words. This is the same layout as the Bitplane class of the C++ version.
  */
 typedef struct
 {
@@ -49,7 +61,8 @@ typedef struct
     int file_version;
     int width;
     int height;
-    char **data;
+    int stride;
+    uint64_t *data;
 } SimpleIcon;
 
 /**
@@ -67,6 +80,8 @@ void SimpleIcon_destroy(SimpleIcon *_si);
 
 /**
  * Load data from given file into a SimpleIcon struct.
+ * Regular files are memory mapped and parsed in place, so there is no
+ * limit on the file size; other files are read into memory completely.
  * @param _si Pointer to struct to be filled
  * @param file File-struct pointer to opened file to read from
  * @return Success or not? (see constants.h)
@@ -75,32 +90,69 @@ int SimpleIcon_loadFromFile(SimpleIcon *_si, FILE *file);
 
 /**
  * Display a SimpleIcon struct's data on screen.
+ * The whole frame is written to stdout with a single fwrite.
  * @param _si Pointer to SimpleIcon to display
  */
 void SimpleIcon_display(SimpleIcon *_si);
 
+/**
+ * Render a SimpleIcon struct's data as "ascii art" into a buffer.
+ * The buffer is grown with realloc when needed, so passing the same
+ * buffer for every frame avoids further allocations.
+ * @param _si Pointer to SimpleIcon to render
+ * @param buffer Pointer to the buffer, may point to 0 initially
+ * @param capacity Pointer to the buffer size in bytes
+ * @return Length of the rendered frame, 0 if memory ran out
+ */
+size_t SimpleIcon_render(const SimpleIcon *_si, char **buffer, size_t *capacity);
+
+/**
+ * Read a single pixel. Coordinates are not range checked.
+ * @param _si Pointer to SimpleIcon to read from
+ * @param x Column of the pixel
+ * @param y Row of the pixel
+ * @return 1 if the pixel is set, 0 otherwise
+ */
+int SimpleIcon_pixel(const SimpleIcon *_si, int x, int y);
+
+/**
+ * Allocate a cleared bitplane of _si->width x _si->height pixels.
+ * Any previously allocated pixel data is released.
+ * @param _si Pointer to struct to allocate pixel data for
+ * @return Success or not? (see constants.h)
+ */
+int SimpleIcon_allocData(SimpleIcon *_si);
+
 /**
  * Parse header data from file contents.
+ * The fields are sliced off the buffer in one pass, only the name is
+ * copied. The buffer does not need to be NUL terminated.
  * @param _si Pointer to SimpleIcon struct to fill
- * @param fileContent String read from file
+ * @param fileContent Content read from file
+ * @param length Length of fileContent in bytes
  * @return Numeric error/success value. One of
  * - SI_NO_ERROR
  * - SI_ILLEGAL_INPUT_FORMAT
  */
-int SimpleIcon_parseHeader(SimpleIcon *_si, const char *fileContent);
+int SimpleIcon_parseHeader(SimpleIcon *_si, const char *fileContent,
+                           size_t length);
 
 /**
  * Parse SimpleIcon version 1 data.
  * @param _si Pointer to struct to fill
- * @param fileData String of icon data read from file
+ * @param fileData Icon data read from file
+ * @param length Length of fileData in bytes
  */
-void SimpleIcon_parseData(SimpleIcon *_si, const char *fileData);
+void SimpleIcon_parseData(SimpleIcon *_si, const char *fileData,
+                          size_t length);
 
 /**
  * Parse SimpleIcon version 2 data.
  * @param _si Pointer to struct to fill
- * @param fileData String of icon data read from file
+ * @param fileData Icon data read from file
+ * @param length Length of fileData in bytes
  */
-void SimpleIcon_parseDataV2(SimpleIcon *_si, const char *fileData);
+void SimpleIcon_parseDataV2(SimpleIcon *_si, const char *fileData,
+                            size_t length);
 
 #endif
@@ -0,0 +1,216 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BinaryFormat.h"
+#include "SimpleIcon.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <iostream>
+using std::endl;
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "pixel sections are copied as little endian words");
+
+const char BinaryFormat::MAGIC[4] = { '\x89', 'S', 'I', 'B' };
+
+namespace {
+
+bool inBounds(uint64_t offset, uint64_t length, uint64_t size)
+{
+    return offset <= size && length <= size - offset;
+}
+
+int illegal(const char *message)
+{
+    std::cerr << message << endl;
+    return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+}
+
+}
+
+bool BinaryFormat::isBinary(string_view content)
+{
+    return content.size() >= sizeof(MAGIC)
+        && std::memcmp(content.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+int BinaryFormat::readHeader(string_view content, Header &header)
+{
+    return readHeader(content, content.size(), header);
+}
+
+int BinaryFormat::readHeader(string_view content, uint64_t fileSize, Header &header)
+{
+    if (!isBinary(content) || content.size() < HEADER_SIZE || fileSize < content.size()) {
+        return illegal("Binary icon header is truncated");
+    }
+
+    const char *data = content.data();
+    header.formatVersion = readLE<uint16_t>(data + 4);
+    header.headerSize = readLE<uint16_t>(data + 6);
+    header.width = readLE<uint32_t>(data + 8);
+    header.height = readLE<uint32_t>(data + 12);
+    header.fileVersion = readLE<uint32_t>(data + 16);
+    header.encoding = readLE<uint32_t>(data + 20);
+    header.stride = readLE<uint32_t>(data + 24);
+    header.nameLength = readLE<uint32_t>(data + 28);
+    header.nameOffset = readLE<uint64_t>(data + 32);
+    header.pixelOffset = readLE<uint64_t>(data + 40);
+    header.pixelLength = readLE<uint64_t>(data + 48);
+    header.checksum = readLE<uint64_t>(data + 56);
+    header.extensionOffset = 0;
+    header.extensionLength = 0;
+
+    if (header.formatVersion == 0 || header.formatVersion > FORMAT_VERSION) {
+        return illegal("Unsupported binary icon format version");
+    }
+    if (header.headerSize < HEADER_SIZE || header.headerSize > fileSize) {
+        return illegal("Illegal binary icon header size");
+    }
+    if (header.headerSize >= EXTENDED_HEADER_SIZE) {
+        if (content.size() < EXTENDED_HEADER_SIZE) {
+            return illegal("Binary icon header is truncated");
+        }
+        header.extensionOffset = readLE<uint64_t>(data + 64);
+        header.extensionLength = readLE<uint64_t>(data + 72);
+    }
+    if (header.encoding != PACKED_ROWS) {
+        return illegal("Unsupported binary icon pixel encoding");
+    }
+    if (!Bitplane::sizeAllowed(header.width, header.height)) {
+        return illegal("Illegal image size");
+    }
+    if (header.stride != uint32_t(Bitplane::strideFor(int(header.width)))
+            || header.pixelLength / 8 / header.stride != header.height
+            || header.pixelLength != uint64_t(header.stride) * header.height * 8) {
+        return illegal("Binary icon pixel section does not match image size");
+    }
+    if (!inBounds(header.nameOffset, header.nameLength, fileSize)
+            || !inBounds(header.pixelOffset, header.pixelLength, fileSize)
+            || !inBounds(header.extensionOffset, header.extensionLength, fileSize)) {
+        return illegal("Binary icon is truncated");
+    }
+
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+string_view BinaryFormat::name(string_view content, const Header &header)
+{
+    return content.substr(header.nameOffset, header.nameLength);
+}
+
+string_view BinaryFormat::extension(string_view content, const Header &header)
+{
+    return content.substr(header.extensionOffset, header.extensionLength);
+}
+
+int BinaryFormat::readPixels(string_view content, const Header &header, Bitplane &pixels)
+{
+    const char *section = content.data() + header.pixelOffset;
+    if (Bitplane::hashBytes(section, header.pixelLength) != header.checksum) {
+        return illegal("Binary icon checksum mismatch");
+    }
+    if (!pixels.reset(int(header.width), int(header.height))) {
+        return illegal("Unable to allocate image data");
+    }
+
+    std::memcpy(pixels.words(), section, header.pixelLength);
+
+    // Keep the cleared padding invariant even for foreign writers.
+    if (header.width % 64) {
+        const uint64_t mask = (uint64_t(1) << (header.width % 64)) - 1;
+        for (int row = 0; row < pixels.height(); ++row) {
+            pixels.row(row)[pixels.stride() - 1] &= mask;
+        }
+    }
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+string BinaryFormat::encode(string_view name, int fileVersion, const Bitplane &pixels,
+                           string_view extension)
+{
+    const uint16_t headerSize = extension.empty() ? HEADER_SIZE : EXTENDED_HEADER_SIZE;
+    const uint64_t nameOffset = headerSize;
+    const uint64_t pixelOffset = (nameOffset + name.size() + Bitplane::ALIGNMENT - 1)
+                                 & ~uint64_t(Bitplane::ALIGNMENT - 1);
+    const uint64_t pixelLength = pixels.sizeInBytes();
+    const uint64_t extensionOffset = pixelOffset + pixelLength;
+
+    string content(extensionOffset + extension.size(), '\0');
+    char *data = &content[0];
+
+    std::memcpy(data, MAGIC, sizeof(MAGIC));
+    writeLE<uint16_t>(data + 4, FORMAT_VERSION);
+    writeLE<uint16_t>(data + 6, headerSize);
+    writeLE<uint32_t>(data + 8, uint32_t(pixels.width()));
+    writeLE<uint32_t>(data + 12, uint32_t(pixels.height()));
+    writeLE<uint32_t>(data + 16, uint32_t(fileVersion));
+    writeLE<uint32_t>(data + 20, PACKED_ROWS);
+    writeLE<uint32_t>(data + 24, uint32_t(pixels.stride()));
+    writeLE<uint32_t>(data + 28, uint32_t(name.size()));
+    writeLE<uint64_t>(data + 32, nameOffset);
+    writeLE<uint64_t>(data + 40, pixelOffset);
+    writeLE<uint64_t>(data + 48, pixelLength);
+    writeLE<uint64_t>(data + 56, Bitplane::hashBytes(pixels.words(), pixelLength));
+    if (!extension.empty()) {
+        writeLE<uint64_t>(data + 64, extensionOffset);
+        writeLE<uint64_t>(data + 72, uint64_t(extension.size()));
+        std::memcpy(data + extensionOffset, extension.data(), extension.size());
+    }
+
+    std::memcpy(data + nameOffset, name.data(), name.size());
+    if (pixelLength) {
+        std::memcpy(data + pixelOffset, pixels.words(), pixelLength);
+    }
+    return content;
+}
+
+bool BinaryFormat::writeAll(const string &file, string_view content)
+{
+    int fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Unable to write file '" << file << "'" << endl;
+        return false;
+    }
+
+    const char *data = content.data();
+    size_t remaining = content.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written <= 0) {
+            break;
+        }
+        data += written;
+        remaining -= size_t(written);
+    }
+
+    bool ok = (::close(fd) == 0) && remaining == 0;
+    if (!ok) {
+        std::cerr << "Unable to write file '" << file << "'" << endl;
+    }
+    return ok;
+}
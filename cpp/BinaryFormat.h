@@ -0,0 +1,219 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BINARYFORMAT_H
+#define BINARYFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+
+/**
+ * Compact binary container for SimpleIcon images.
+ *
+ * Layout, all integers little endian:
+ *
+ *     offset size field
+ *          0    4 magic "\x89SIB"
+ *          4    2 format version (FORMAT_VERSION)
+ *          6    2 header size, readers skip unknown trailing header fields
+ *          8    4 width
+ *         12    4 height
+ *         16    4 text file version the image was converted from
+ *         20    4 pixel encoding (Encoding)
+ *         24    4 row stride in 64 bit words
+ *         28    4 name length in bytes
+ *         32    8 name offset
+ *         40    8 pixel offset, a multiple of 64
+ *         48    8 pixel length in bytes
+ *         56    8 checksum of the pixel section (Bitplane::hashBytes)
+ *         64    8 extension offset  \  only if the header size is at
+ *         72    8 extension length  /  least EXTENDED_HEADER_SIZE
+ *
+ * The name section follows the header, the pixel section holds the rows
+ * exactly in Bitplane layout, so loading is one header read plus one bulk
+ * copy and the file is about 8 times smaller than the text formats.
+ *
+ * The optional extension section after the pixels carries data of other
+ * tools, e.g. the table of an IconAtlas. Readers that do not know it still
+ * load the image.
+ */
+class BinaryFormat
+{
+public:
+    /** File signature, never valid at the start of a text file. */
+    static const char MAGIC[4];
+
+    /** Newest container version understood by this reader. */
+    static const uint16_t FORMAT_VERSION = 1;
+
+    /** Size of the fixed header written by this version. */
+    static const uint16_t HEADER_SIZE = 64;
+
+    /** Size of a header with extension fields. */
+    static const uint16_t EXTENDED_HEADER_SIZE = 80;
+
+    /**
+     * Pixel section encodings.
+     */
+    enum Encoding {
+        PACKED_ROWS = 0
+    };
+
+    /**
+     * Decoded fixed header.
+     */
+    struct Header
+    {
+        uint16_t formatVersion;
+        uint16_t headerSize;
+        uint32_t width;
+        uint32_t height;
+        uint32_t fileVersion;
+        uint32_t encoding;
+        uint32_t stride;
+        uint32_t nameLength;
+        uint64_t nameOffset;
+        uint64_t pixelOffset;
+        uint64_t pixelLength;
+        uint64_t checksum;
+        uint64_t extensionOffset;   ///< 0 if there is no extension
+        uint64_t extensionLength;
+    };
+
+    /**
+     * Whether the content starts with the binary signature.
+     */
+    static bool isBinary(string_view content);
+
+    /**
+     * Read and validate the header, including all section bounds.
+     * @param content Complete file content
+     * @param header Receives the header fields
+     * @return Some value from SimpleIcon::Error
+     */
+    static int readHeader(string_view content, Header &header);
+
+    /**
+     * Read and validate the header when only the start of the file is in
+     * memory, e.g. to list icons without reading their pixels.
+     * @param prefix Start of the file, at least HEADER_SIZE bytes
+     * @param fileSize Size of the complete file
+     * @param header Receives the header fields
+     * @return Some value from SimpleIcon::Error
+     */
+    static int readHeader(string_view prefix, uint64_t fileSize, Header &header);
+
+    /**
+     * Name stored in a validated file.
+     */
+    static string_view name(string_view content, const Header &header);
+
+    /**
+     * Extension section of a validated file, empty if there is none.
+     */
+    static string_view extension(string_view content, const Header &header);
+
+    /**
+     * Copy the pixel section of a validated file into a bitplane.
+     * @param content Complete file content
+     * @param header Header as returned by readHeader()
+     * @param pixels Receives the image
+     * @return Some value from SimpleIcon::Error
+     */
+    static int readPixels(string_view content, const Header &header, Bitplane &pixels);
+
+    /**
+     * Serialize an image into a complete binary file.
+     * @param name Name of the image
+     * @param fileVersion Text file version to record
+     * @param pixels Image data
+     * @param extension Content of the extension section, none if empty
+     * @return File content
+     */
+    static string encode(string_view name, int fileVersion, const Bitplane &pixels,
+                         string_view extension = string_view());
+
+    // HELPERS, shared with the other file formats
+
+    /**
+     * Read a little endian integer.
+     * @param data At least sizeof(T) bytes
+     */
+    template<typename T>
+    static T readLE(const char *data);
+
+    /**
+     * Write a little endian integer in place.
+     * @param data Receives sizeof(T) bytes
+     */
+    template<typename T>
+    static void writeLE(char *data, T value);
+
+    /**
+     * Append a little endian integer.
+     */
+    template<typename T>
+    static void appendLE(string &out, T value);
+
+    /**
+     * Write content to a file, reporting a failure on stderr.
+     * @param file Path to write to, an existing file is replaced
+     * @param content Data to write
+     * @return true if everything was written
+     */
+    static bool writeAll(const string &file, string_view content);
+};
+
+template<typename T>
+T BinaryFormat::readLE(const char *data)
+{
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value |= T(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+template<typename T>
+void BinaryFormat::writeLE(char *data, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        data[i] = char((uint64_t(value) >> (8 * i)) & 0xff);
+    }
+}
+
+template<typename T>
+void BinaryFormat::appendLE(string &out, T value)
+{
+    char data[sizeof(T)];
+    writeLE<T>(data, value);
+    out.append(data, sizeof(T));
+}
+
+#endif
@@ -0,0 +1,316 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Bitplane.h"
+#include "IconArena.h"
+#include "SimpleIconStats.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+static_assert(sizeof(std::atomic<unsigned long>) + sizeof(bool) <= Bitplane::ALIGNMENT,
+              "Bitplane header does not fit in front of the pixels");
+
+static size_t sMaxSizeInBytes = Bitplane::DEFAULT_MAX_SIZE_IN_BYTES;
+
+Bitplane::Bitplane() :
+    mWidth(0), mHeight(0), mStride(0), mView(false), mWords(0), mArena(0), mOwner()
+{
+}
+
+Bitplane::Bitplane(int width, int height) :
+    Bitplane()
+{
+    reset(width, height);
+}
+
+Bitplane Bitplane::view(const uint64_t *words, int width, int height,
+                        std::shared_ptr<const void> owner)
+{
+    Bitplane pixels;
+    if (words && width > 0 && height > 0) {
+        pixels.mWidth = width;
+        pixels.mHeight = height;
+        pixels.mStride = strideFor(width);
+        pixels.mView = true;
+        // Never written through: every modifying accessor detaches first.
+        pixels.mWords = const_cast<uint64_t *>(words);
+        pixels.mOwner = std::move(owner);
+    }
+    return pixels;
+}
+
+Bitplane::Bitplane(const Bitplane &other) :
+    Bitplane()
+{
+    *this = other;
+}
+
+Bitplane::Bitplane(Bitplane &&other) noexcept :
+    mWidth(other.mWidth), mHeight(other.mHeight), mStride(other.mStride),
+    mView(other.mView), mWords(other.mWords), mArena(other.mArena),
+    mOwner(std::move(other.mOwner))
+{
+    other.mWidth = other.mHeight = other.mStride = 0;
+    other.mView = false;
+    other.mWords = 0;
+}
+
+Bitplane::~Bitplane()
+{
+    clear();
+}
+
+Bitplane & Bitplane::operator=(const Bitplane &other)
+{
+    if (this == &other || (mWords && mWords == other.mWords)) {
+        return *this;
+    }
+
+    if (other.empty()) {
+        clear();
+    } else if (!share(other) && reset(other.mWidth, other.mHeight)) {
+        std::memcpy(mWords, other.mWords, sizeInBytes());
+    }
+    return *this;
+}
+
+Bitplane & Bitplane::operator=(Bitplane &&other) noexcept
+{
+    if (this != &other) {
+        clear();
+        std::swap(mWidth, other.mWidth);
+        std::swap(mHeight, other.mHeight);
+        std::swap(mStride, other.mStride);
+        std::swap(mView, other.mView);
+        std::swap(mWords, other.mWords);
+        std::swap(mArena, other.mArena);
+        std::swap(mOwner, other.mOwner);
+    }
+    return *this;
+}
+
+bool Bitplane::reset(int width, int height)
+{
+    clear();
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    int stride = strideFor(width);
+    mWords = allocate(size_t(stride) * size_t(height) * sizeof(uint64_t), mArena);
+    if (!mWords) {
+        return false;
+    }
+
+    mWidth = width;
+    mHeight = height;
+    mStride = stride;
+    return true;
+}
+
+void Bitplane::clear()
+{
+    if (!mView) {
+        release(mWords);
+    }
+    mView = false;
+    mOwner.reset();
+    mWords = 0;
+    mWidth = mHeight = mStride = 0;
+}
+
+void Bitplane::fillRange(int y, int begin, int end)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    uint64_t *bits = row(y);
+    const int first = begin >> 6;
+    const int last = (end - 1) >> 6;
+    const uint64_t head = ~uint64_t(0) << (begin & 63);
+    const uint64_t tail = ~uint64_t(0) >> (63 - ((end - 1) & 63));
+
+    if (first == last) {
+        bits[first] |= head & tail;
+        return;
+    }
+    bits[first] |= head;
+    for (int word = first + 1; word < last; ++word) {
+        bits[word] = ~uint64_t(0);
+    }
+    bits[last] |= tail;
+}
+
+int Bitplane::findNext(int y, int from, bool on) const
+{
+    if (from >= mWidth) {
+        return mWidth;
+    }
+
+    const uint64_t *bits = row(y);
+    const uint64_t flip = on ? 0 : ~uint64_t(0);
+    int word = from >> 6;
+    uint64_t pending = (bits[word] ^ flip) & (~uint64_t(0) << (from & 63));
+
+    while (!pending) {
+        if (++word >= mStride) {
+            return mWidth;
+        }
+        pending = bits[word] ^ flip;
+    }
+
+    int col = word * 64 + __builtin_ctzll(pending);
+    return col < mWidth ? col : mWidth;
+}
+
+uint64_t Bitplane::hash() const
+{
+    uint64_t size[2] = { uint64_t(mWidth), uint64_t(mHeight) };
+    return hashBytes(mWords, sizeInBytes(), hashBytes(size, sizeof(size)));
+}
+
+uint64_t Bitplane::hashBytes(const void *data, size_t length, uint64_t seed)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+
+    for (; length >= 8; bytes += 8, length -= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    if (length > 0) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes, length);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+bool Bitplane::sizeAllowed(uint64_t width, uint64_t height)
+{
+    if (width == 0 || height == 0 || width > INT_MAX || height > INT_MAX) {
+        return false;
+    }
+    // At most 2^25 words per row and 2^31 rows, so this cannot overflow.
+    const uint64_t bytes = (width + 63) / 64 * height * sizeof(uint64_t);
+    return bytes <= sMaxSizeInBytes;
+}
+
+size_t Bitplane::maxSizeInBytes()
+{
+    return sMaxSizeInBytes;
+}
+
+void Bitplane::setMaxSizeInBytes(size_t bytes)
+{
+    sMaxSizeInBytes = bytes;
+}
+
+size_t Bitplane::sizeInBytes() const
+{
+    return size_t(mStride) * size_t(mHeight) * sizeof(uint64_t);
+}
+
+bool Bitplane::detach()
+{
+    uint64_t *words = allocate(sizeInBytes(), mArena);
+    if (!words) {
+        return false;
+    }
+    std::memcpy(words, mWords, sizeInBytes());
+    if (!mView) {
+        release(mWords);
+    }
+    mView = false;
+    mOwner.reset();
+    mWords = words;
+    return true;
+}
+
+bool Bitplane::share(const Bitplane &other)
+{
+    // Arena blocks must not outlive their arena through a copy, and a
+    // bitplane bound to an arena keeps its own pixels in there. The same
+    // goes for the memory behind a view.
+    if (mArena || other.mView || other.header()->fromArena) {
+        return false;
+    }
+
+    other.header()->refs.fetch_add(1, std::memory_order_relaxed);
+    clear();
+    mWidth = other.mWidth;
+    mHeight = other.mHeight;
+    mStride = other.mStride;
+    mWords = other.mWords;
+    return true;
+}
+
+uint64_t * Bitplane::allocate(size_t bytes, IconArena *arena)
+{
+    void *block = 0;
+    // Round up so the block always spans whole cache lines.
+    bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (bytes == 0) {
+        return 0;
+    }
+    if (arena) {
+        block = arena->allocate(ALIGNMENT + bytes, ALIGNMENT);
+        if (!block) {
+            return 0;
+        }
+    } else {
+        if (posix_memalign(&block, ALIGNMENT, ALIGNMENT + bytes) != 0) {
+            return 0;
+        }
+        SIMPLEICON_ALLOCATION(ALIGNMENT + bytes);
+    }
+
+    Header *header = static_cast<Header *>(block);
+    new (&header->refs) std::atomic<unsigned long>(1);
+    header->fromArena = arena != 0;
+
+    char *words = static_cast<char *>(block) + ALIGNMENT;
+    std::memset(words, 0, bytes);
+    return reinterpret_cast<uint64_t *>(words);
+}
+
+void Bitplane::release(uint64_t *words)
+{
+    if (!words) {
+        return;
+    }
+
+    Header *header = reinterpret_cast<Header *>(reinterpret_cast<char *>(words) - ALIGNMENT);
+    if (header->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 && !header->fromArena) {
+        std::free(header);
+    }
+}
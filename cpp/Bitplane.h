@@ -0,0 +1,288 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+class IconArena;
+
+/**
+ * Contiguous 1 bit per pixel storage for SimpleIcon image data.
+ *
+ * All rows live in one 64-byte aligned block. Each row starts on a 64 bit
+ * word boundary and holds pixel x in bit (x % 64) of word (x / 64), so a
+ * row is stride() words long. Bits beyond width() in the last word of a
+ * row are always kept cleared.
+ *
+ * The block comes from the heap, or from an IconArena set with setArena().
+ *
+ * Bitplane is a value type with copy-on-write sharing: copies of a heap
+ * block share it under a reference count, and the first modifying access
+ * (set(), orBlock(), the non-const row() / words(), ...) of a shared
+ * bitplane copies the block first; if that copy cannot be allocated they
+ * throw std::bad_alloc, while unshare() reports it by its result instead.
+ * Copies of an arena block are always made on the heap so they do not
+ * depend on the arena. Sharing is safe across threads, modifying one
+ * Bitplane object from several threads is safe for disjoint rows only
+ * once it is not shared.
+ *
+ * A view() reads pixels from memory it does not own, such as a read-only
+ * shared memory segment, and never writes to it; an owner object keeps
+ * that memory alive as long as the view. It counts as shared, so
+ * modifying it and copying it both copy the pixels to the heap first.
+ */
+class Bitplane
+{
+public:
+    /** Alignment of the pixel block in bytes. */
+    static const size_t ALIGNMENT = 64;
+
+    /** Default for maxSizeInBytes(): 1 GiB of pixels. */
+    static const size_t DEFAULT_MAX_SIZE_IN_BYTES = size_t(1) << 30;
+
+    /**
+     * Construct an empty bitplane without any pixel storage.
+     */
+    Bitplane();
+
+    /**
+     * Construct a bitplane of the given size with all pixels cleared.
+     * @param width Number of pixels per row
+     * @param height Number of rows
+     */
+    Bitplane(int width, int height);
+
+    /**
+     * Construct a read-only view of pixels in the layout described above.
+     * @param words First word of row 0, must not change while viewed
+     * @param width Number of pixels per row
+     * @param height Number of rows
+     * @param owner Keeps the memory of the pixels alive, may be empty if
+     * the caller guarantees that itself
+     */
+    static Bitplane view(const uint64_t *words, int width, int height,
+                         std::shared_ptr<const void> owner = std::shared_ptr<const void>());
+
+    Bitplane(const Bitplane &other);
+    Bitplane(Bitplane &&other) noexcept;
+    ~Bitplane();
+
+    Bitplane & operator=(const Bitplane &other);
+    Bitplane & operator=(Bitplane &&other) noexcept;
+
+    /**
+     * Discard current content and allocate a cleared bitplane.
+     * @param width Number of pixels per row
+     * @param height Number of rows
+     * @return false if the memory could not be allocated
+     */
+    bool reset(int width, int height);
+
+    /**
+     * Release the pixel storage.
+     */
+    void clear();
+
+    /**
+     * Take the storage of later reset() calls from an arena. Memory from
+     * an arena is never freed individually; the arena must outlive it.
+     * @param arena Arena to allocate from, 0 for the heap
+     */
+    void setArena(IconArena *arena) { mArena = arena; }
+    IconArena * arena() const { return mArena; }
+
+    /**
+     * Read a single pixel. Coordinates are not range checked.
+     * @param x Column of the pixel
+     * @param y Row of the pixel
+     * @return true if the pixel is set
+     */
+    bool get(int x, int y) const
+    {
+        return (mWords[y * mStride + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    /**
+     * Write a single pixel. Coordinates are not range checked.
+     * @param x Column of the pixel
+     * @param y Row of the pixel
+     * @param on New pixel value
+     */
+    void set(int x, int y, bool on)
+    {
+        unshareForWrite();
+        uint64_t &word = mWords[y * mStride + (x >> 6)];
+        uint64_t mask = uint64_t(1) << (x & 63);
+        word = on ? (word | mask) : (word & ~mask);
+    }
+
+    /**
+     * OR a run of 8 pixels into a row, as stored in version 2 files.
+     * @param block Index of the run, it covers columns 8 * block and up
+     * @param y Row of the pixels
+     * @param bits Pixels of the run, bit i is column 8 * block + i
+     */
+    void orBlock(int block, int y, uint64_t bits)
+    {
+        unshareForWrite();
+        mWords[y * mStride + (block >> 3)] |= (bits & 0xff) << ((block & 7) * 8);
+    }
+
+    /**
+     * Set the pixels [begin, end) of a row.
+     * @param y Row of the pixels
+     * @param begin First column to set
+     * @param end Column after the last one to set, at most width()
+     */
+    void fillRange(int y, int begin, int end);
+
+    /**
+     * Find the first column at or after `from` whose pixel equals `on`.
+     * @param y Row to scan
+     * @param from Column to start at
+     * @param on Pixel value to look for
+     * @return The column, or width() if there is none
+     */
+    int findNext(int y, int from, bool on) const;
+
+    // GETTER
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int stride() const { return mStride; }
+    bool empty() const { return mWords == 0; }
+    bool isView() const { return mView; }
+    size_t sizeInBytes() const;
+
+    const uint64_t * row(int y) const { return mWords + y * mStride; }
+    uint64_t * row(int y) { unshareForWrite(); return mWords + y * mStride; }
+    const uint64_t * words() const { return mWords; }
+    uint64_t * words() { unshareForWrite(); return mWords; }
+
+    /**
+     * Copy the pixel block if it is shared, so it can be modified. In
+     * place operations call this first to report a failed copy.
+     * @return false if the copy could not be allocated; the bitplane is
+     * unchanged then
+     */
+    bool unshare()
+    {
+        return !isShared() || detach();
+    }
+
+    /**
+     * Whether the pixel block is shared with other Bitplane objects, or
+     * not owned at all.
+     */
+    bool isShared() const
+    {
+        return mWords && (mView || header()->refs.load(std::memory_order_acquire) != 1);
+    }
+
+    /**
+     * Hash of size and pixel content, equal for equal images.
+     */
+    uint64_t hash() const;
+
+    /**
+     * FNV-1a style hash over 64 bit words. A trailing
+     * partial word is zero padded.
+     * @param data Start of the data, no alignment required
+     * @param length Length in bytes
+     * @param seed Initial hash value, e.g. to chain several calls
+     */
+    static uint64_t hashBytes(const void *data, size_t length,
+                              uint64_t seed = HASH_SEED);
+
+    /** Initial value of hashBytes(). */
+    static const uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+
+    /**
+     * Number of 64 bit words needed for a row of the given width.
+     * @param width Number of pixels per row
+     */
+    static int strideFor(int width) { return int((int64_t(width) + 63) >> 6); }
+
+    /**
+     * Whether parsers accept an image of the given size: both dimensions
+     * are in 1..INT_MAX and the pixel block is at most maxSizeInBytes().
+     * @param width Number of pixels per row
+     * @param height Number of rows
+     */
+    static bool sizeAllowed(uint64_t width, uint64_t height);
+
+    /**
+     * Largest pixel block, in bytes, of an image read from a file.
+     */
+    static size_t maxSizeInBytes();
+
+    /**
+     * Set the largest pixel block, in bytes, of an image read from a file.
+     */
+    static void setMaxSizeInBytes(size_t bytes);
+
+private:
+    /**
+     * Bookkeeping in the ALIGNMENT bytes in front of the pixel words.
+     */
+    struct Header
+    {
+        std::atomic<unsigned long> refs;
+        bool fromArena;
+    };
+
+    int mWidth;
+    int mHeight;
+    int mStride;
+    bool mView;         ///< mWords is not ours and has no Header
+    uint64_t *mWords;
+    IconArena *mArena;
+    std::shared_ptr<const void> mOwner; ///< keeps the words of a view alive
+
+    Header * header() const
+    {
+        return reinterpret_cast<Header *>(reinterpret_cast<char *>(mWords) - ALIGNMENT);
+    }
+
+    /**
+     * unshare() for the modifying accessors, which cannot return an error.
+     */
+    void unshareForWrite()
+    {
+        if (!unshare()) {
+            throw std::bad_alloc();
+        }
+    }
+
+    bool detach();
+    bool share(const Bitplane &other);
+    static uint64_t * allocate(size_t bytes, IconArena *arena);
+    static void release(uint64_t *words);
+};
+
+#endif
@@ -0,0 +1,259 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BitplaneAnalysis.h"
+#include "BitplaneOps.h"
+
+#include <algorithm>
+
+namespace {
+
+/**
+ * Count the set bits of consecutive words. Meant to run inside
+ * BitplaneOps::withPopcount(); four independent sums keep several POPCNTs
+ * in flight.
+ */
+inline uint64_t countWords(const uint64_t *words, size_t count)
+{
+    uint64_t sum[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        sum[0] += uint64_t(__builtin_popcountll(words[i]));
+        sum[1] += uint64_t(__builtin_popcountll(words[i + 1]));
+        sum[2] += uint64_t(__builtin_popcountll(words[i + 2]));
+        sum[3] += uint64_t(__builtin_popcountll(words[i + 3]));
+    }
+    for (; i < count; ++i) {
+        sum[0] += uint64_t(__builtin_popcountll(words[i]));
+    }
+    return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+/**
+ * Union-find over component labels with path halving. The smaller label
+ * becomes the root, so roots are in order of first appearance.
+ */
+int findRoot(std::vector<int> &parent, int label)
+{
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+void unite(std::vector<int> &parent, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+}
+
+uint64_t BitplaneAnalysis::countPixels(const Bitplane &pixels)
+{
+    // Padding bits are always cleared, so the rows can be counted as one
+    // block.
+    uint64_t total = 0;
+    BitplaneOps::withPopcount([&] {
+        total = countWords(pixels.words(), size_t(pixels.stride()) * size_t(pixels.height()));
+    });
+    return total;
+}
+
+int BitplaneAnalysis::countRow(const Bitplane &pixels, int y)
+{
+    uint64_t total = 0;
+    BitplaneOps::withPopcount([&] {
+        total = countWords(pixels.row(y), size_t(pixels.stride()));
+    });
+    return int(total);
+}
+
+void BitplaneAnalysis::countRows(const Bitplane &pixels, std::vector<int> &counts)
+{
+    counts.resize(size_t(pixels.height()));
+    BitplaneOps::withPopcount([&] {
+        for (int y = 0; y < pixels.height(); ++y) {
+            counts[size_t(y)] = int(countWords(pixels.row(y), size_t(pixels.stride())));
+        }
+    });
+}
+
+BitplaneAnalysis::Rect BitplaneAnalysis::boundingBox(const Bitplane &pixels)
+{
+    Rect box = { 0, 0, 0, 0 };
+    const int stride = pixels.stride();
+    auto rowEmpty = [&](int y) {
+        const uint64_t *words = pixels.row(y);
+        for (int word = 0; word < stride; ++word) {
+            if (words[word]) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    int top = 0;
+    while (top < pixels.height() && rowEmpty(top)) {
+        ++top;
+    }
+    if (top == pixels.height()) {
+        return box;
+    }
+    int bottom = pixels.height() - 1;
+    while (rowEmpty(bottom)) {
+        --bottom;
+    }
+
+    // Per row, only the words left of the leftmost and right of the
+    // rightmost set word seen so far need looking at.
+    int leftWord = stride - 1;
+    int rightWord = 0;
+    uint64_t leftBits = 0;
+    uint64_t rightBits = 0;
+    for (int y = top; y <= bottom; ++y) {
+        const uint64_t *words = pixels.row(y);
+        for (int word = 0; word <= leftWord; ++word) {
+            if (words[word]) {
+                leftBits = word < leftWord ? words[word] : leftBits | words[word];
+                leftWord = word;
+                break;
+            }
+        }
+        for (int word = stride - 1; word >= rightWord; --word) {
+            if (words[word]) {
+                rightBits = word > rightWord ? words[word] : rightBits | words[word];
+                rightWord = word;
+                break;
+            }
+        }
+    }
+
+    box.x = leftWord * 64 + __builtin_ctzll(leftBits);
+    box.y = top;
+    box.width = rightWord * 64 + 63 - __builtin_clzll(rightBits) - box.x + 1;
+    box.height = bottom - top + 1;
+    return box;
+}
+
+int BitplaneAnalysis::labelComponents(const Bitplane &pixels, std::vector<Component> &components,
+                                      Connectivity connectivity, std::vector<Run> *runs)
+{
+    components.clear();
+    std::vector<Run> local;
+    std::vector<Run> &all = runs ? *runs : local;
+    all.clear();
+    std::vector<int> parent;
+
+    // Runs of two rows touch if their column ranges overlap, widened by
+    // one column for diagonal neighbours.
+    const int reach = connectivity == EIGHT ? 1 : 0;
+    size_t previous = 0;
+    for (int y = 0; y < pixels.height(); ++y) {
+        const size_t current = all.size();
+        size_t above = previous;
+        auto addRun = [&](int begin, int end) {
+            Run run = { y, begin, end, -1 };
+            // Skip runs above that end left of this one; the last one
+            // checked may still touch the next run, so do not step past it.
+            while (above < current && all[above].end + reach <= run.begin) {
+                ++above;
+            }
+            for (size_t i = above; i < current && all[i].begin < run.end + reach; ++i) {
+                if (run.component < 0) {
+                    run.component = all[i].component;
+                } else {
+                    unite(parent, run.component, all[i].component);
+                }
+            }
+            if (run.component < 0) {
+                run.component = int(parent.size());
+                parent.push_back(run.component);
+            }
+            all.push_back(run);
+        };
+
+        // Runs start at 0->1 and end at 1->0 transitions; search each word
+        // for the next transition with a bit scan.
+        const uint64_t *words = pixels.row(y);
+        bool inRun = false;
+        int begin = 0;
+        for (int word = 0; word < pixels.stride(); ++word) {
+            const uint64_t bits = words[word];
+            uint64_t pending = inRun ? ~bits : bits;
+            while (pending) {
+                const int bit = __builtin_ctzll(pending);
+                if (inRun) {
+                    addRun(begin, word * 64 + bit);
+                } else {
+                    begin = word * 64 + bit;
+                }
+                inRun = !inRun;
+                pending = (inRun ? ~bits : bits) & (~uint64_t(0) << bit);
+            }
+        }
+        if (inRun) {
+            addRun(begin, pixels.width());
+        }
+        previous = current;
+    }
+
+    // Number the roots in order and collect their bounds.
+    std::vector<int> index(parent.size(), -1);
+    for (size_t label = 0; label < parent.size(); ++label) {
+        const int root = findRoot(parent, int(label));
+        if (index[size_t(root)] < 0) {
+            index[size_t(root)] = int(components.size());
+            components.push_back(Component());
+        }
+        index[label] = index[size_t(root)];
+    }
+
+    std::vector<int> right(components.size(), -1);
+    std::vector<int> bottom(components.size(), -1);
+    for (Run &run : all) {
+        run.component = index[size_t(run.component)];
+        Component &component = components[size_t(run.component)];
+        const size_t i = size_t(run.component);
+        if (right[i] < 0) {
+            component.bounds.x = run.begin;
+            component.bounds.y = run.y;
+            component.pixels = 0;
+        }
+        component.bounds.x = std::min(component.bounds.x, run.begin);
+        right[i] = std::max(right[i], run.end);
+        bottom[i] = run.y + 1;
+        component.pixels += uint64_t(run.end - run.begin);
+    }
+    for (size_t i = 0; i < components.size(); ++i) {
+        components[i].bounds.width = right[i] - components[i].bounds.x;
+        components[i].bounds.height = bottom[i] - components[i].bounds.y;
+    }
+    return int(components.size());
+}
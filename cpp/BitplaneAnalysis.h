@@ -0,0 +1,122 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BITPLANEANALYSIS_H
+#define BITPLANEANALYSIS_H
+
+#include <vector>
+
+#include "Bitplane.h"
+
+/**
+ * Measurements over Bitplane images for layout and hit testing: pixel
+ * counts, bounding boxes and connected components.
+ *
+ * Everything works on whole 64 pixel words. Counting uses the POPCNT
+ * instruction where PixelDecoder::isa() and the CPU allow it, and
+ * component labeling merges runs of set pixels instead of single pixels.
+ */
+class BitplaneAnalysis
+{
+public:
+    /**
+     * Axis aligned rectangle in pixels.
+     */
+    struct Rect
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+
+        bool empty() const { return width <= 0 || height <= 0; }
+    };
+
+    /**
+     * Horizontal run of set pixels in one row.
+     */
+    struct Run
+    {
+        int y;
+        int begin;      ///< first column
+        int end;        ///< column after the last one
+        int component;  ///< index into the component list
+    };
+
+    /**
+     * Set of touching pixels.
+     */
+    struct Component
+    {
+        Rect bounds;
+        uint64_t pixels;
+    };
+
+    /**
+     * Which neighbours count as touching.
+     */
+    enum Connectivity {
+        FOUR = 4,   ///< left, right, above and below
+        EIGHT = 8   ///< diagonals as well
+    };
+
+    /**
+     * Number of set pixels in the image.
+     */
+    static uint64_t countPixels(const Bitplane &pixels);
+
+    /**
+     * Number of set pixels in one row.
+     * @param y Row to count, 0 <= y < height()
+     */
+    static int countRow(const Bitplane &pixels, int y);
+
+    /**
+     * Number of set pixels in each row.
+     * @param counts Receives height() counts
+     */
+    static void countRows(const Bitplane &pixels, std::vector<int> &counts);
+
+    /**
+     * Smallest rectangle containing all set pixels.
+     * @return The rectangle, empty if no pixel is set
+     */
+    static Rect boundingBox(const Bitplane &pixels);
+
+    /**
+     * Label the connected components of the set pixels.
+     * Components are listed in the order of their first pixel, scanning
+     * rows top to bottom and each row left to right.
+     * @param pixels Image to label
+     * @param components Receives the components
+     * @param connectivity Which neighbours count as touching
+     * @param runs Receives the runs of set pixels with their component,
+     * row by row, if not null
+     * @return Number of components
+     */
+    static int labelComponents(const Bitplane &pixels, std::vector<Component> &components,
+                               Connectivity connectivity = EIGHT,
+                               std::vector<Run> *runs = 0);
+};
+
+#endif
@@ -0,0 +1,373 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "BitplaneOps.h"
+#include "PixelDecoder.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLEICON_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+uint64_t apply(BitplaneOps::Op op, uint64_t target, uint64_t source)
+{
+    switch (op) {
+    case BitplaneOps::COPY:
+        return source;
+    case BitplaneOps::AND:
+        return target & source;
+    case BitplaneOps::OR:
+        return target | source;
+    case BitplaneOps::XOR:
+        return target ^ source;
+    case BitplaneOps::AND_NOT:
+        return target & ~source;
+    }
+    return target;
+}
+
+/**
+ * Apply op to count whole words.
+ */
+void applyWordsScalar(uint64_t *target, const uint64_t *source, size_t count,
+                      BitplaneOps::Op op)
+{
+    switch (op) {
+    case BitplaneOps::COPY:
+        std::copy(source, source + count, target);
+        break;
+    case BitplaneOps::AND:
+        for (size_t i = 0; i < count; ++i) {
+            target[i] &= source[i];
+        }
+        break;
+    case BitplaneOps::OR:
+        for (size_t i = 0; i < count; ++i) {
+            target[i] |= source[i];
+        }
+        break;
+    case BitplaneOps::XOR:
+        for (size_t i = 0; i < count; ++i) {
+            target[i] ^= source[i];
+        }
+        break;
+    case BitplaneOps::AND_NOT:
+        for (size_t i = 0; i < count; ++i) {
+            target[i] &= ~source[i];
+        }
+        break;
+    }
+}
+
+#ifdef SIMPLEICON_X86
+__attribute__((target("avx2")))
+void applyWordsAvx2(uint64_t *target, const uint64_t *source, size_t count,
+                    BitplaneOps::Op op)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i *t = reinterpret_cast<__m256i *>(target + i);
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(source + i));
+        __m256i v = _mm256_loadu_si256(t);
+        switch (op) {
+        case BitplaneOps::COPY:
+            v = s;
+            break;
+        case BitplaneOps::AND:
+            v = _mm256_and_si256(v, s);
+            break;
+        case BitplaneOps::OR:
+            v = _mm256_or_si256(v, s);
+            break;
+        case BitplaneOps::XOR:
+            v = _mm256_xor_si256(v, s);
+            break;
+        case BitplaneOps::AND_NOT:
+            v = _mm256_andnot_si256(s, v);
+            break;
+        }
+        _mm256_storeu_si256(t, v);
+    }
+    applyWordsScalar(target + i, source + i, count - i, op);
+}
+#endif
+
+typedef void (*ApplyWords)(uint64_t *, const uint64_t *, size_t, BitplaneOps::Op);
+
+ApplyWords applierFor(PixelDecoder::Isa isa)
+{
+#ifdef SIMPLEICON_X86
+    if (isa >= PixelDecoder::AVX2) {
+        return applyWordsAvx2;
+    }
+#endif
+    (void) isa;
+    return applyWordsScalar;
+}
+
+/**
+ * 64 pixels of a row starting at column `bit`, which may be negative or
+ * beyond the row; pixels outside the row read as cleared.
+ */
+uint64_t extract(const uint64_t *row, int words, long bit)
+{
+    long word = bit >= 0 ? bit / 64 : -((63 - bit) / 64);
+    int shift = int(bit - word * 64);
+    uint64_t low = (word >= 0 && word < words) ? row[word] : 0;
+    if (shift == 0) {
+        return low;
+    }
+    uint64_t high = (word + 1 >= 0 && word + 1 < words) ? row[word + 1] : 0;
+    return (low >> shift) | (high << (64 - shift));
+}
+
+/**
+ * count words of a row starting at column `bit`, as extract() would
+ * return them; only the words touching the row's ends are bounds checked.
+ */
+void extractWords(const uint64_t *row, int words, long bit, uint64_t *out, int count)
+{
+    const long base = bit >= 0 ? bit / 64 : -((63 - bit) / 64);
+    const int shift = int(bit - base * 64);
+    const int begin = int(std::min<long>(count, std::max<long>(0, -base)));
+    const int end = std::max(begin, int(std::min<long>(count, long(words) - 1 - base)));
+
+    for (int i = 0; i < begin; ++i) {
+        out[i] = extract(row, words, bit + long(i) * 64);
+    }
+    const uint64_t *src = row + base;
+    if (shift == 0) {
+        std::copy(src + begin, src + end, out + begin);
+    } else {
+        for (int i = begin; i < end; ++i) {
+            out[i] = (src[i] >> shift) | (src[i + 1] << (64 - shift));
+        }
+    }
+    for (int i = end; i < count; ++i) {
+        out[i] = extract(row, words, bit + long(i) * 64);
+    }
+}
+
+uint64_t reverseBits(uint64_t v)
+{
+    v = __builtin_bswap64(v);
+    v = ((v >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((v & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    return v;
+}
+
+/**
+ * Transpose a 64x64 bit matrix in place: bit c of a[r] swaps with bit r
+ * of a[c].
+ */
+void transpose64(uint64_t *a)
+{
+    uint64_t mask = 0x00000000ffffffffULL;
+    for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & mask;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
+        }
+    }
+}
+
+uint64_t lastWordMask(int width)
+{
+    int used = width & 63;
+    return used ? (uint64_t(1) << used) - 1 : ~uint64_t(0);
+}
+
+}
+
+bool BitplaneOps::combine(Bitplane &target, const Bitplane &source, Op op, int x, int y)
+{
+    if (target.empty() || source.empty()) {
+        return true;
+    }
+    if (&target == &source) {
+        // Rows may be overwritten before they are read; work on a shared
+        // copy, which target detaches from below.
+        const Bitplane copy(source);
+        return !copy.empty() && combine(target, copy, op, x, y);
+    }
+
+    const long x0 = std::max<long>(x, 0);
+    const long x1 = std::min<long>(long(x) + source.width(), target.width());
+    const long y0 = std::max<long>(y, 0);
+    const long y1 = std::min<long>(long(y) + source.height(), target.height());
+    if (x0 >= x1 || y0 >= y1) {
+        return true;
+    }
+    if (!target.unshare()) {
+        return false;
+    }
+
+    const int first = int(x0 >> 6);
+    const int last = int((x1 - 1) >> 6);
+    const uint64_t head = ~uint64_t(0) << (x0 & 63);
+    const uint64_t tail = ~uint64_t(0) >> (63 - ((x1 - 1) & 63));
+    const bool aligned = (x & 63) == 0;
+    const ApplyWords applyWords = applierFor(PixelDecoder::isa());
+    std::vector<uint64_t> shifted(aligned ? 0 : size_t(last - first + 1));
+
+    for (long row = y0; row < y1; ++row) {
+        const uint64_t *src = source.row(int(row - y));
+        uint64_t *dst = target.row(int(row));
+
+        // Source words lined up with target words first..last.
+        if (aligned) {
+            src += first - (x >> 6);
+        } else {
+            extractWords(src, source.stride(), long(first) * 64 - x, shifted.data(),
+                         last - first + 1);
+            src = shifted.data();
+        }
+
+        if (first == last) {
+            const uint64_t mask = head & tail;
+            dst[first] = (dst[first] & ~mask) | (apply(op, dst[first], src[0]) & mask);
+            continue;
+        }
+
+        dst[first] = (dst[first] & ~head) | (apply(op, dst[first], src[0]) & head);
+        applyWords(dst + first + 1, src + 1, size_t(last - first - 1), op);
+        dst[last] = (dst[last] & ~tail) | (apply(op, dst[last], src[last - first]) & tail);
+    }
+    return true;
+}
+
+bool BitplaneOps::invert(Bitplane &pixels)
+{
+    if (pixels.empty()) {
+        return true;
+    }
+    if (!pixels.unshare()) {
+        return false;
+    }
+
+    const int stride = pixels.stride();
+    const uint64_t mask = lastWordMask(pixels.width());
+    for (int row = 0; row < pixels.height(); ++row) {
+        uint64_t *words = pixels.row(row);
+        for (int word = 0; word < stride; ++word) {
+            words[word] = ~words[word];
+        }
+        words[stride - 1] &= mask;
+    }
+    return true;
+}
+
+Bitplane BitplaneOps::crop(const Bitplane &pixels, int x, int y, int width, int height)
+{
+    const long x0 = std::max<long>(x, 0);
+    const long y0 = std::max<long>(y, 0);
+    const long x1 = std::min<long>(long(x) + width, pixels.width());
+    const long y1 = std::min<long>(long(y) + height, pixels.height());
+
+    Bitplane result;
+    if (x0 < x1 && y0 < y1 && result.reset(int(x1 - x0), int(y1 - y0))) {
+        combine(result, pixels, COPY, int(-x0), int(-y0));
+    }
+    return result;
+}
+
+bool BitplaneOps::flipHorizontal(Bitplane &pixels)
+{
+    if (pixels.empty()) {
+        return true;
+    }
+    if (!pixels.unshare()) {
+        return false;
+    }
+
+    // Reversing the words of a row puts the padding in front; shifting
+    // by its width moves the pixels back to column 0.
+    const int stride = pixels.stride();
+    const int padding = stride * 64 - pixels.width();
+    std::vector<uint64_t> reversed(static_cast<size_t>(stride));
+
+    for (int row = 0; row < pixels.height(); ++row) {
+        uint64_t *words = pixels.row(row);
+        for (int word = 0; word < stride; ++word) {
+            reversed[stride - 1 - word] = reverseBits(words[word]);
+        }
+        extractWords(reversed.data(), stride, padding, words, stride);
+    }
+    return true;
+}
+
+bool BitplaneOps::flipVertical(Bitplane &pixels)
+{
+    if (!pixels.unshare()) {
+        return false;
+    }
+
+    const int stride = pixels.stride();
+    for (int top = 0, bottom = pixels.height() - 1; top < bottom; ++top, --bottom) {
+        std::swap_ranges(pixels.row(top), pixels.row(top) + stride, pixels.row(bottom));
+    }
+    return true;
+}
+
+Bitplane BitplaneOps::transpose(const Bitplane &pixels)
+{
+    Bitplane result;
+    if (pixels.empty() || !result.reset(pixels.height(), pixels.width())) {
+        return result;
+    }
+
+    uint64_t block[64];
+    for (int blockRow = 0; blockRow < pixels.height(); blockRow += 64) {
+        const int rows = std::min(64, pixels.height() - blockRow);
+        for (int blockCol = 0; blockCol < pixels.stride(); ++blockCol) {
+            for (int r = 0; r < 64; ++r) {
+                block[r] = r < rows ? pixels.row(blockRow + r)[blockCol] : 0;
+            }
+            transpose64(block);
+
+            const int cols = std::min(64, pixels.width() - blockCol * 64);
+            for (int c = 0; c < cols; ++c) {
+                result.row(blockCol * 64 + c)[blockRow >> 6] = block[c];
+            }
+        }
+    }
+    return result;
+}
+
+Bitplane BitplaneOps::rotate90(const Bitplane &pixels, bool clockwise)
+{
+    Bitplane result = transpose(pixels);
+    if (clockwise) {
+        flipHorizontal(result);
+    } else {
+        flipVertical(result);
+    }
+    return result;
+}
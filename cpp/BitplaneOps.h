@@ -0,0 +1,138 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BITPLANEOPS_H
+#define BITPLANEOPS_H
+
+#include "Bitplane.h"
+#include "PixelDecoder.h"
+
+/**
+ * Image operations working on whole 64 pixel words of Bitplane rows.
+ *
+ * Combining runs one boolean operation per word (AVX2 on 256 bits at a
+ * time where PixelDecoder::isa() allows it); sources at an offset that is
+ * not a multiple of 64 pixels are funnel shifted into place one row at a
+ * time. Rotation transposes 64x64 pixel blocks with word operations.
+ * Padding bits beyond the width stay cleared.
+ */
+class BitplaneOps
+{
+public:
+    /**
+     * How source pixels are merged into the target.
+     */
+    enum Op {
+        COPY = 0,       ///< target = source
+        AND = 1,        ///< target = target & source
+        OR = 2,         ///< target = target | source
+        XOR = 3,        ///< target = target ^ source
+        AND_NOT = 4     ///< target = target & ~source, i.e. mask out
+    };
+
+    /**
+     * Merge a source image into the target, in place. Only the pixels the
+     * source covers at the given offset change; parts outside the target
+     * are clipped.
+     * @param target Image to modify
+     * @param source Image to merge in
+     * @param op Merge operation
+     * @param x Column of the source's left edge in the target, may be
+     * negative
+     * @param y Row of the source's top edge in the target, may be negative
+     * @return false if the target's pixels were shared and could not be
+     * copied (Bitplane::unshare()); the target is unchanged then
+     */
+    static bool combine(Bitplane &target, const Bitplane &source, Op op,
+                        int x = 0, int y = 0);
+
+    /**
+     * Invert all pixels in place.
+     * @return false if the pixels could not be unshared, as for combine()
+     */
+    static bool invert(Bitplane &pixels);
+
+    /**
+     * Copy a rectangle out of an image. The rectangle is clipped to the
+     * image.
+     * @return The rectangle's pixels, empty if nothing is left after
+     * clipping
+     */
+    static Bitplane crop(const Bitplane &pixels, int x, int y, int width, int height);
+
+    /**
+     * Mirror the image left to right, in place.
+     * @return false if the pixels could not be unshared, as for combine()
+     */
+    static bool flipHorizontal(Bitplane &pixels);
+
+    /**
+     * Mirror the image top to bottom, in place.
+     * @return false if the pixels could not be unshared, as for combine()
+     */
+    static bool flipVertical(Bitplane &pixels);
+
+    /**
+     * Swap rows and columns: pixel (x, y) moves to (y, x).
+     */
+    static Bitplane transpose(const Bitplane &pixels);
+
+    /**
+     * Rotate the image by 90 degrees.
+     * @param pixels Image to rotate
+     * @param clockwise Direction of the rotation
+     */
+    static Bitplane rotate90(const Bitplane &pixels, bool clockwise = true);
+
+    /**
+     * Run a bit counting kernel. The kernel is inlined into a copy compiled
+     * for the POPCNT instruction, which is used where
+     * PixelDecoder::usePopcnt() allows it, and into a portable copy
+     * otherwise, so __builtin_popcountll in its body becomes one
+     * instruction where the CPU has it.
+     * @param kernel Small callable without arguments, e.g. a lambda
+     */
+    template <typename Kernel>
+    static void withPopcount(Kernel kernel)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (PixelDecoder::usePopcnt()) {
+            runPopcnt(kernel);
+            return;
+        }
+#endif
+        kernel();
+    }
+
+private:
+#if defined(__x86_64__) || defined(__i386__)
+    template <typename Kernel>
+    __attribute__((target("popcnt")))
+    static void runPopcnt(Kernel &kernel)
+    {
+        kernel();
+    }
+#endif
+};
+
+#endif
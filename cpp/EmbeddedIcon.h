@@ -0,0 +1,277 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EMBEDDEDICON_H
+#define EMBEDDEDICON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include "SimpleIcon.h"
+
+/**
+ * Compile time parsing of the text format, for icons built into the
+ * program. Use SIMPLEICON_EMBED rather than these functions directly.
+ *
+ * The header follows the rules of SimpleIcon::parseHeaderFields. Line
+ * breaks in the data field are skipped as when loading a file, so long
+ * payloads can be split over several string literals with "\n". Unlike
+ * loading at run time, the data field must hold exactly width * height
+ * digits '0' or '1'. Only versions 1 and 2 can be embedded.
+ */
+class EmbeddedIconFormat
+{
+public:
+    /**
+     * Fields of an embedded icon's text.
+     */
+    struct Header
+    {
+        std::string_view name;
+        int fileVersion;
+        int width;
+        int height;
+        std::string_view data;
+    };
+
+    /**
+     * Parse and validate the header fields.
+     */
+    static constexpr Header header(std::string_view text)
+    {
+        Header header = { std::string_view(), 0, 0, 0, std::string_view() };
+        size_t pos = text.find(DELIM);
+        if (pos == std::string_view::npos) {
+            illegal("embedded icon has illegal format (expect 4 fields)");
+        }
+        header.name = text.substr(0, pos);
+        pos += DELIM.size();
+
+        header.fileVersion = positive(text, pos);
+        if (!atDelim(text, pos)) {
+            illegal("illegal file version in embedded icon header");
+        }
+        if (header.fileVersion != 1 && header.fileVersion != 2) {
+            illegal("only versions 1 and 2 can be embedded");
+        }
+        pos += DELIM.size();
+
+        header.width = positive(text, pos);
+        if (pos >= text.size() || text[pos] != 'x') {
+            illegal("illegal image size in embedded icon header");
+        }
+        header.height = positive(text, ++pos);
+        if (!atDelim(text, pos)) {
+            illegal("illegal image size in embedded icon header");
+        }
+        header.data = text.substr(pos + DELIM.size());
+        return header;
+    }
+
+    /**
+     * Reached only for invalid icons. Not being constexpr, it turns the
+     * error into a compile error naming this function and the reason.
+     */
+    static void illegal(const char *reason)
+    {
+        std::fputs(reason, stderr);
+        std::abort();
+    }
+
+private:
+    static constexpr std::string_view DELIM = ";;";
+
+    static constexpr bool isBlank(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    static constexpr bool atDelim(std::string_view text, size_t pos)
+    {
+        return text.substr(pos < text.size() ? pos : text.size(), DELIM.size()) == DELIM;
+    }
+
+    /**
+     * Parse a positive decimal number at pos, skipping blanks around it.
+     */
+    static constexpr int positive(std::string_view text, size_t &pos)
+    {
+        while (pos < text.size() && isBlank(text[pos])) {
+            ++pos;
+        }
+        if (pos >= text.size() || text[pos] < '0' || text[pos] > '9') {
+            illegal("expected a positive number in embedded icon header");
+        }
+        long long value = 0;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+            value = value * 10 + (text[pos++] - '0');
+            if (value > 0x7fffffff) {
+                illegal("number too large in embedded icon header");
+            }
+        }
+        if (value == 0) {
+            illegal("expected a positive number in embedded icon header");
+        }
+        while (pos < text.size() && isBlank(text[pos])) {
+            ++pos;
+        }
+        return int(value);
+    }
+};
+
+/**
+ * Icon decoded at compile time into packed rows in Bitplane layout.
+ *
+ * Provides the read-only accessors of SimpleIcon without any work at
+ * startup; icon() makes a SimpleIcon copy for rendering and the image
+ * operations. Create instances with SIMPLEICON_EMBED:
+ *
+ *     constexpr auto SWORD = SIMPLEICON_EMBED("Schwert;;2;;10x3;;"
+ *                                             "001000001111111100100000001100");
+ *
+ * Decoding needs a few constexpr operations per pixel; icons of more than
+ * about 100k pixels may need a higher -fconstexpr-ops-limit.
+ *
+ * @tparam Width Image width
+ * @tparam Height Image height
+ */
+template <int Width, int Height>
+class EmbeddedIcon
+{
+public:
+    /** Row stride in 64 bit words, as Bitplane::strideFor(Width). */
+    static constexpr int STRIDE = (Width + 63) / 64;
+
+    /**
+     * Parse an icon's text. Call only through SIMPLEICON_EMBED, which
+     * makes sure this happens at compile time.
+     */
+    constexpr explicit EmbeddedIcon(std::string_view text) :
+        mName(), mFileVersion(0), mWords()
+    {
+        const EmbeddedIconFormat::Header header = EmbeddedIconFormat::header(text);
+        if (header.width != Width || header.height != Height) {
+            EmbeddedIconFormat::illegal("embedded icon size does not match its type");
+        }
+        mName = header.name;
+        mFileVersion = header.fileVersion;
+
+        // Version 2 stores 8 pixel wide column blocks of all rows, the last
+        // block as wide as what is left.
+        const size_t blockSize = size_t(8) * size_t(Height);
+        size_t digit = 0;
+        for (char c : header.data) {
+            if (c == '\n' || c == '\r') {
+                continue;
+            }
+            if ((c != '0' && c != '1') || digit >= size_t(Width) * size_t(Height)) {
+                EmbeddedIconFormat::illegal("embedded icon data must be width * height digits 0 or 1");
+            }
+            int x = int(digit % size_t(Width));
+            int y = int(digit / size_t(Width));
+            if (mFileVersion == 2) {
+                const int block = int(digit / blockSize);
+                const int blockWidth = Width - block * 8 < 8 ? Width - block * 8 : 8;
+                x = block * 8 + int(digit % blockSize) % blockWidth;
+                y = int(digit % blockSize) / blockWidth;
+            }
+            if (c == '1') {
+                mWords[y * STRIDE + (x >> 6)] |= uint64_t(1) << (x & 63);
+            }
+            ++digit;
+        }
+        if (digit != size_t(Width) * size_t(Height)) {
+            EmbeddedIconFormat::illegal("embedded icon data must be width * height digits 0 or 1");
+        }
+    }
+
+    // GETTER, as in SimpleIcon
+
+    constexpr int error() const { return SimpleIcon::Error::NO_ERROR; }
+    constexpr std::string_view name() const { return mName; }
+    constexpr int fileVersion() const { return mFileVersion; }
+    constexpr int width() const { return Width; }
+    constexpr int height() const { return Height; }
+
+    /**
+     * Read a single pixel.
+     * @param x Column of the pixel, 0 <= x < width()
+     * @param y Row of the pixel, 0 <= y < height()
+     */
+    constexpr bool pixel(int x, int y) const
+    {
+        return (mWords[y * STRIDE + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    /**
+     * Copy one row in Bitplane layout.
+     * @param y Row to read
+     * @param out Receives STRIDE words
+     */
+    void readRow(int y, uint64_t *out) const
+    {
+        for (int word = 0; word < STRIDE; ++word) {
+            out[word] = mWords[y * STRIDE + word];
+        }
+    }
+
+    /**
+     * Packed rows, STRIDE words per row, padding bits cleared.
+     */
+    constexpr const uint64_t * words() const { return mWords; }
+
+    /**
+     * Copy of the icon as a SimpleIcon.
+     */
+    SimpleIcon icon() const
+    {
+        Bitplane pixels(Width, Height);
+        for (int y = 0; y < Height; ++y) {
+            readRow(y, pixels.row(y));
+        }
+        return SimpleIcon(string(mName), mFileVersion, std::move(pixels));
+    }
+
+private:
+    std::string_view mName;
+    int mFileVersion;
+    uint64_t mWords[size_t(STRIDE) * size_t(Height)];
+};
+
+/**
+ * Parse an icon literal at compile time into an EmbeddedIcon. Format
+ * errors are compile errors.
+ * @param text String literal in the text format, e.g.
+ * "Schwert;;1;;10x3;;001000000011111111110010000000"
+ */
+#define SIMPLEICON_EMBED(text) \
+    ([] { \
+        constexpr ::EmbeddedIconFormat::Header header = ::EmbeddedIconFormat::header(text); \
+        constexpr ::EmbeddedIcon<header.width, header.height> icon(text); \
+        return icon; \
+    }())
+
+#endif
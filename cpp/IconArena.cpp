@@ -0,0 +1,144 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IconArena.h"
+#include "SimpleIconStats.h"
+
+#include <cstdlib>
+#include <cstring>
+
+IconArena::IconArena(size_t blockSize) :
+    mBlockSize(blockSize < BLOCK_ALIGNMENT ? BLOCK_ALIGNMENT : blockSize),
+    mMutex(), mBlocks(), mCurrent(0), mUsed(0)
+{
+}
+
+IconArena::~IconArena()
+{
+    release();
+}
+
+void * IconArena::allocate(size_t bytes, size_t alignment)
+{
+    if (bytes == 0) {
+        bytes = 1;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Try the current block and any block left over from before reset().
+    for (; mCurrent < mBlocks.size(); ++mCurrent) {
+        char *memory = allocateFromBlock(mBlocks[mCurrent], bytes, alignment);
+        if (memory) {
+            return memory;
+        }
+        // Oversized requests get their own block, keep filling this one.
+        if (bytes > mBlockSize / 4) {
+            break;
+        }
+    }
+
+    size_t size = bytes > mBlockSize / 4 ? bytes : mBlockSize;
+    size = (size + BLOCK_ALIGNMENT - 1) & ~(BLOCK_ALIGNMENT - 1);
+    void *data = 0;
+    if (posix_memalign(&data, BLOCK_ALIGNMENT, size) != 0) {
+        return 0;
+    }
+    SIMPLEICON_ALLOCATION(size);
+
+    Block block = { static_cast<char *>(data), size, 0 };
+    if (size == mBlockSize || mCurrent >= mBlocks.size()) {
+        // Regular block: becomes the current one.
+        mBlocks.push_back(block);
+        mCurrent = mBlocks.size() - 1;
+        return allocateFromBlock(mBlocks.back(), bytes, alignment);
+    }
+    // Dedicated block: insert it before the current one, which stays open.
+    mBlocks.insert(mBlocks.begin() + mCurrent, block);
+    ++mCurrent;
+    return allocateFromBlock(mBlocks[mCurrent - 1], bytes, alignment);
+}
+
+std::string_view IconArena::copy(std::string_view text)
+{
+    if (text.empty()) {
+        return std::string_view();
+    }
+    char *memory = static_cast<char *>(allocate(text.size(), 1));
+    if (!memory) {
+        return std::string_view();
+    }
+    std::memcpy(memory, text.data(), text.size());
+    return std::string_view(memory, text.size());
+}
+
+void IconArena::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (Block &block : mBlocks) {
+        block.used = 0;
+    }
+    mCurrent = 0;
+    mUsed = 0;
+}
+
+void IconArena::release()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (Block &block : mBlocks) {
+        std::free(block.data);
+    }
+    mBlocks.clear();
+    mCurrent = 0;
+    mUsed = 0;
+}
+
+// GETTER
+
+size_t IconArena::blockSize() const
+{
+    return mBlockSize;
+}
+
+size_t IconArena::blockCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBlocks.size();
+}
+
+size_t IconArena::bytesUsed() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUsed;
+}
+
+char * IconArena::allocateFromBlock(Block &block, size_t bytes, size_t alignment)
+{
+    size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+    if (offset > block.size || block.size - offset < bytes) {
+        return 0;
+    }
+    mUsed += offset + bytes - block.used;
+    block.used = offset + bytes;
+    return block.data + offset;
+}
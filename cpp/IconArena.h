@@ -0,0 +1,114 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ICONARENA_H
+#define ICONARENA_H
+
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/**
+ * Bump allocator for the names and pixel buffers of many icons.
+ *
+ * Memory is carved out of a few large blocks and only given back all at
+ * once, by reset() or when the arena is destroyed. Loading a batch of
+ * icons into one arena therefore costs a handful of malloc calls instead
+ * of several per icon. Every icon built on an arena must be destroyed
+ * before the arena is reset or destroyed. allocate() may be called from
+ * several threads at once.
+ */
+class IconArena
+{
+public:
+    /** Default size of a block in bytes. */
+    static const size_t DEFAULT_BLOCK_SIZE = size_t(1) << 20;
+
+    /** Alignment of every block in bytes, same as Bitplane::ALIGNMENT. */
+    static const size_t BLOCK_ALIGNMENT = 64;
+
+    /**
+     * Construct an empty arena, blocks are allocated on first use.
+     * @param blockSize Size of a regular block; larger requests get a
+     * block of their own
+     */
+    explicit IconArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    IconArena(const IconArena &) = delete;
+    IconArena & operator=(const IconArena &) = delete;
+
+    ~IconArena();
+
+    /**
+     * Allocate uninitialized memory.
+     * @param bytes Size of the memory
+     * @param alignment Power of two up to BLOCK_ALIGNMENT
+     * @return The memory, or 0 if no block could be allocated
+     */
+    void * allocate(size_t bytes, size_t alignment);
+
+    /**
+     * Copy a string into the arena.
+     * @param text String to copy
+     * @return View of the copy, empty if it could not be allocated
+     */
+    std::string_view copy(std::string_view text);
+
+    /**
+     * Make all memory available again but keep the blocks for reuse.
+     */
+    void reset();
+
+    /**
+     * Give all blocks back to the system.
+     */
+    void release();
+
+    // GETTER
+    size_t blockSize() const;
+    size_t blockCount() const;
+
+    /**
+     * Bytes handed out since the last reset(), including padding.
+     */
+    size_t bytesUsed() const;
+
+private:
+    struct Block
+    {
+        char *data;
+        size_t size;
+        size_t used;
+    };
+
+    size_t mBlockSize;
+    mutable std::mutex mMutex;
+    std::vector<Block> mBlocks;
+    size_t mCurrent;
+    size_t mUsed;
+
+    char * allocateFromBlock(Block &block, size_t bytes, size_t alignment);
+};
+
+#endif
@@ -0,0 +1,296 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IconAtlas.h"
+#include "BinaryFormat.h"
+#include "BitplaneOps.h"
+#include "MappedFile.h"
+#include "SimpleIcon.h"
+#include "StagedImages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include <iostream>
+using std::endl;
+
+const char IconAtlas::TABLE_MAGIC[4] = { 'S', 'I', 'A', 'T' };
+
+namespace {
+
+const size_t TABLE_HEADER_SIZE = 16;
+const size_t RECT_SIZE = 16;
+const size_t ICON_SIZE = 16;
+const size_t SLOT_SIZE = 4;
+
+}
+
+IconAtlas::IconAtlas() :
+    mStaged(), mOwner(), mContent(),
+    mTable(), mIconCount(0), mRectCount(0), mSlotCount(0), mPixels()
+{
+}
+
+bool IconAtlas::add(const SimpleIcon &icon, string_view name)
+{
+    return mStaged.add(icon, name);
+}
+
+bool IconAtlas::build(string_view name)
+{
+    const std::vector<Bitplane> &images = mStaged.images();
+    if (images.empty()) {
+        std::cerr << "No icons to put into the atlas" << endl;
+        return false;
+    }
+
+    // Shelves tallest first waste the least height; a roughly square
+    // atlas keeps the rows short.
+    std::vector<size_t> order(images.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::sort(order.begin(), order.end(), [&images](size_t a, size_t b) {
+        if (images[a].height() != images[b].height()) {
+            return images[a].height() > images[b].height();
+        }
+        return images[a].width() > images[b].width();
+    });
+
+    uint64_t area = 0;
+    int widest = 0;
+    for (const Bitplane &image : images) {
+        area += uint64_t(image.width()) * uint64_t(image.height());
+        widest = std::max(widest, image.width());
+    }
+    const int targetWidth = std::max(widest, int(std::ceil(std::sqrt(double(area)))));
+
+    std::vector<BitplaneAnalysis::Rect> rects(images.size());
+    int x = 0;
+    int y = 0;
+    int shelf = 0;
+    int width = 0;
+    for (size_t image : order) {
+        const int w = images[image].width();
+        const int h = images[image].height();
+        if (x + w > targetWidth) {
+            y += shelf;
+            x = 0;
+            shelf = 0;
+        }
+        rects[image] = BitplaneAnalysis::Rect{ x, y, w, h };
+        x += w;
+        shelf = std::max(shelf, h);
+        width = std::max(width, x);
+    }
+
+    Bitplane atlas;
+    if (!atlas.reset(width, y + shelf)) {
+        std::cerr << "Unable to allocate image data" << endl;
+        return false;
+    }
+    for (size_t image = 0; image < images.size(); ++image) {
+        BitplaneOps::combine(atlas, images[image], BitplaneOps::OR, rects[image].x, rects[image].y);
+    }
+
+    // Table, see the class documentation.
+    const std::vector<StagedImages::Icon> &icons = mStaged.icons();
+    const std::vector<uint32_t> slots = mStaged.nameSlots();
+    const size_t namesOffset = TABLE_HEADER_SIZE + rects.size() * RECT_SIZE
+                               + icons.size() * ICON_SIZE + slots.size() * SLOT_SIZE;
+    string table(TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    BinaryFormat::appendLE<uint32_t>(table, uint32_t(icons.size()));
+    BinaryFormat::appendLE<uint32_t>(table, uint32_t(rects.size()));
+    BinaryFormat::appendLE<uint32_t>(table, uint32_t(slots.size()));
+    for (const BitplaneAnalysis::Rect &rect : rects) {
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(rect.x));
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(rect.y));
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(rect.width));
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(rect.height));
+    }
+    size_t nameOffset = namesOffset;
+    for (const StagedImages::Icon &icon : icons) {
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(nameOffset));
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(icon.name.size()));
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(icon.image));
+        BinaryFormat::appendLE<uint32_t>(table, uint32_t(icon.fileVersion));
+        nameOffset += icon.name.size();
+    }
+    for (uint32_t value : slots) {
+        BinaryFormat::appendLE<uint32_t>(table, value);
+    }
+    for (const StagedImages::Icon &icon : icons) {
+        table += icon.name;
+    }
+
+    std::shared_ptr<string> content =
+        std::make_shared<string>(BinaryFormat::encode(name, 1, atlas, table));
+    return open(*content, content);
+}
+
+bool IconAtlas::save(const string &file) const
+{
+    if (mContent.empty()) {
+        std::cerr << "Atlas has not been built" << endl;
+        return false;
+    }
+
+    return BinaryFormat::writeAll(file, mContent);
+}
+
+bool IconAtlas::load(const string &file)
+{
+    std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>(file);
+    if (!mapped->isOpen()) {
+        std::cerr << "Unable to open atlas '" << file << "'" << endl;
+        return false;
+    }
+    if (!open(mapped->view(), mapped)) {
+        std::cerr << "'" << file << "' is not an icon atlas" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool IconAtlas::open(string_view content, std::shared_ptr<const void> owner)
+{
+    BinaryFormat::Header header;
+    if (BinaryFormat::readHeader(content, header) != SimpleIcon::Error::NO_ERROR) {
+        return false;
+    }
+
+    const string_view table = BinaryFormat::extension(content, header);
+    if (table.size() < TABLE_HEADER_SIZE
+            || std::memcmp(table.data(), TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0) {
+        return false;
+    }
+    const uint32_t icons = BinaryFormat::readLE<uint32_t>(table.data() + 4);
+    const uint32_t rects = BinaryFormat::readLE<uint32_t>(table.data() + 8);
+    const uint32_t slots = BinaryFormat::readLE<uint32_t>(table.data() + 12);
+    if (slots <= icons || (slots & (slots - 1)) != 0
+            || TABLE_HEADER_SIZE + uint64_t(rects) * RECT_SIZE + uint64_t(icons) * ICON_SIZE
+               + uint64_t(slots) * SLOT_SIZE > table.size()) {
+        return false;
+    }
+
+    Bitplane pixels;
+    if (BinaryFormat::readPixels(content, header, pixels) != SimpleIcon::Error::NO_ERROR) {
+        return false;
+    }
+
+    mOwner = std::move(owner);
+    mContent = content;
+    mTable = table;
+    mIconCount = icons;
+    mRectCount = rects;
+    mSlotCount = slots;
+    mPixels = std::move(pixels);
+    return true;
+}
+
+bool IconAtlas::find(string_view name, Entry &entry) const
+{
+    if (mSlotCount == 0) {
+        return false;
+    }
+
+    const char *slots = mTable.data() + TABLE_HEADER_SIZE + size_t(mRectCount) * RECT_SIZE
+                        + size_t(mIconCount) * ICON_SIZE;
+    uint32_t s = uint32_t(StagedImages::hashName(name)) & (mSlotCount - 1);
+    // A free slot ends the probe; the bound only matters for damaged files.
+    for (uint32_t probe = 0; probe < mSlotCount; ++probe) {
+        const uint32_t value = BinaryFormat::readLE<uint32_t>(slots + size_t(s) * SLOT_SIZE);
+        if (value == 0) {
+            return false;
+        }
+        if (this->entry(value - 1, entry) && entry.name == name) {
+            return true;
+        }
+        s = (s + 1) & (mSlotCount - 1);
+    }
+    return false;
+}
+
+bool IconAtlas::entry(size_t index, Entry &entry) const
+{
+    if (index >= mIconCount) {
+        return false;
+    }
+
+    const char *icon = mTable.data() + TABLE_HEADER_SIZE + size_t(mRectCount) * RECT_SIZE
+                       + index * ICON_SIZE;
+    const uint32_t nameOffset = BinaryFormat::readLE<uint32_t>(icon);
+    const uint32_t nameLength = BinaryFormat::readLE<uint32_t>(icon + 4);
+    const uint32_t rect = BinaryFormat::readLE<uint32_t>(icon + 8);
+    if (nameOffset > mTable.size() || nameLength > mTable.size() - nameOffset
+            || rect >= mRectCount) {
+        return false;
+    }
+
+    const char *bounds = mTable.data() + TABLE_HEADER_SIZE + size_t(rect) * RECT_SIZE;
+    const uint32_t x = BinaryFormat::readLE<uint32_t>(bounds);
+    const uint32_t y = BinaryFormat::readLE<uint32_t>(bounds + 4);
+    const uint32_t width = BinaryFormat::readLE<uint32_t>(bounds + 8);
+    const uint32_t height = BinaryFormat::readLE<uint32_t>(bounds + 12);
+    if (width == 0 || height == 0 || x > uint32_t(mPixels.width()) || y > uint32_t(mPixels.height())
+            || width > uint32_t(mPixels.width()) - x || height > uint32_t(mPixels.height()) - y) {
+        return false;
+    }
+
+    entry.name = mTable.substr(nameOffset, nameLength);
+    entry.fileVersion = int(BinaryFormat::readLE<uint32_t>(icon + 12));
+    entry.rect = BitplaneAnalysis::Rect{ int(x), int(y), int(width), int(height) };
+    return true;
+}
+
+bool IconAtlas::icon(string_view name, SimpleIcon &icon) const
+{
+    Entry found;
+    if (!find(name, found)) {
+        return false;
+    }
+    icon = SimpleIcon(string(found.name), found.fileVersion,
+                      BitplaneOps::crop(mPixels, found.rect.x, found.rect.y,
+                                        found.rect.width, found.rect.height));
+    return true;
+}
+
+size_t IconAtlas::size() const
+{
+    return mIconCount;
+}
+
+size_t IconAtlas::uniqueImages() const
+{
+    return mRectCount;
+}
+
+size_t IconAtlas::staged() const
+{
+    return mStaged.size();
+}
+
+const Bitplane & IconAtlas::pixels() const
+{
+    return mPixels;
+}
@@ -0,0 +1,191 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+#include "BitplaneAnalysis.h"
+#include "StagedImages.h"
+
+class SimpleIcon;
+
+/**
+ * Many icons packed into one image, with a table from name to rectangle.
+ *
+ * Icons with identical pixels are stored once (StagedImages). The unique
+ * images are packed on shelves, tallest first.
+ *
+ * An atlas file is a BinaryFormat file of the packed image, so any reader
+ * can load it as a single icon. Its extension section holds the table,
+ * all integers little endian:
+ *
+ *     offset size field
+ *          0    4 magic "SIAT"
+ *          4    4 icon count N
+ *          8    4 rectangle count R
+ *         12    4 hash slot count S, a power of two larger than N
+ *         16 R*16 rectangles: x, y, width, height
+ *          . N*16 icons: name offset in the table, name length, rectangle,
+ *                 file version
+ *          .  S*4 open addressing hash of the names: icon index + 1, or 0
+ *                 for a free slot, probing onwards from slot h & (S - 1),
+ *                 h being StagedImages::hashName(name), that is
+ *                 Bitplane::hashBytes(name) run through the murmur3 64 bit
+ *                 finalizer
+ *          .    . names
+ *
+ * Loading maps the file and copies the packed image; the table is used in
+ * place without parsing it, so finding an icon by name is O(1) however
+ * many icons the atlas holds.
+ */
+class IconAtlas
+{
+public:
+    /** Signature of the table in the BinaryFormat extension section. */
+    static const char TABLE_MAGIC[4];
+
+    /**
+     * Position of an icon in the atlas.
+     */
+    struct Entry
+    {
+        string_view name;   ///< valid as long as the atlas is unchanged
+        int fileVersion;
+        BitplaneAnalysis::Rect rect;
+    };
+
+    /**
+     * Construct an empty atlas.
+     */
+    IconAtlas();
+
+    // BUILDING
+
+    /**
+     * Stage an icon for the next build().
+     * @param icon Icon to add
+     * @param name Name to file the icon under, the icon's own name if
+     * empty; must not have been added before
+     * @return true if the icon was added
+     */
+    bool add(const SimpleIcon &icon, string_view name = string_view());
+
+    /**
+     * Pack all staged icons into the atlas image and create its table.
+     * Afterwards find() and icon() answer for the staged icons.
+     * @param name Name of the atlas image
+     * @return true if there was at least one icon to pack
+     */
+    bool build(string_view name = "atlas");
+
+    /**
+     * Write the atlas as built or loaded.
+     * @param file Path to write to, an existing file is replaced
+     * @return true if the file was written completely
+     */
+    bool save(const string &file) const;
+
+    // LOADING
+
+    /**
+     * Load an atlas file written by save().
+     * @param file Path of the atlas
+     * @return true if the file is a valid atlas
+     */
+    bool load(const string &file);
+
+    // ACCESS
+
+    /**
+     * Look up an icon by name.
+     * @param name Name of the icon
+     * @param entry Receives its position
+     * @return true if the atlas holds the icon
+     */
+    bool find(string_view name, Entry &entry) const;
+
+    /**
+     * Read an icon entry by index, in the order the icons were added.
+     * @param index 0 <= index < size()
+     * @param entry Receives its position
+     * @return false if the entry is damaged
+     */
+    bool entry(size_t index, Entry &entry) const;
+
+    /**
+     * Copy an icon out of the atlas.
+     * @param name Name of the icon
+     * @param icon Receives the icon
+     * @return true if the atlas holds the icon
+     */
+    bool icon(string_view name, SimpleIcon &icon) const;
+
+    /**
+     * Number of icons in the atlas.
+     */
+    size_t size() const;
+
+    /**
+     * Number of distinct images in the atlas.
+     */
+    size_t uniqueImages() const;
+
+    /**
+     * Number of icons staged for the next build().
+     */
+    size_t staged() const;
+
+    /**
+     * The packed atlas image.
+     */
+    const Bitplane & pixels() const;
+
+private:
+    StagedImages mStaged;
+
+    std::shared_ptr<const void> mOwner; ///< keeps mContent alive
+    string_view mContent;               ///< complete atlas file
+    string_view mTable;
+    uint32_t mIconCount;
+    uint32_t mRectCount;
+    uint32_t mSlotCount;
+    Bitplane mPixels;
+
+    /**
+     * Validate atlas file content and use it.
+     * @param owner Keeps the content alive
+     */
+    bool open(string_view content, std::shared_ptr<const void> owner);
+};
+
+#endif
@@ -0,0 +1,385 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IconIndex.h"
+#include "BinaryFormat.h"
+#include "Bitplane.h"
+#include "MappedFile.h"
+#include "SimpleIcon.h"
+#include "SimpleIconBatch.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include <iostream>
+using std::endl;
+
+namespace {
+
+const char INDEX_MAGIC[4] = { '\x89', 'S', 'I', 'X' };
+const size_t INDEX_HEADER_SIZE = 12;
+const size_t RECORD_SIZE = 64;
+
+/** Bytes read per step while looking for the end of a text header. */
+const size_t READ_STEP = 4096;
+
+/** Longest text header accepted, name plus version and size fields. */
+const size_t MAX_HEADER_LENGTH = 65536;
+
+/**
+ * Extend prefix to the first `length` bytes of the file, or the whole
+ * file if it is shorter.
+ */
+bool readPrefix(int fd, uint64_t fileSize, size_t length, string &prefix)
+{
+    if (length > fileSize) {
+        length = size_t(fileSize);
+    }
+    size_t have = prefix.size();
+    prefix.resize(length > have ? length : have);
+    while (have < length) {
+        ssize_t count = pread(fd, &prefix[have], length - have, off_t(have));
+        if (count <= 0) {
+            prefix.resize(have);
+            return false;
+        }
+        have += size_t(count);
+    }
+    return true;
+}
+
+bool stampOf(const struct stat &st, int64_t &modified)
+{
+    modified = int64_t(st.st_mtim.tv_sec) * 1000000000 + int64_t(st.st_mtim.tv_nsec);
+    return S_ISREG(st.st_mode);
+}
+
+}
+
+IconIndex::Entry::Entry() :
+    mFile(), mName(), mFileVersion(0), mWidth(0), mHeight(0), mFlags(0),
+    mOffset(0), mPayloadLength(0), mFingerprint(0), mModified(0), mFileSize(0)
+{
+}
+
+IconIndex::IconIndex() :
+    mEntries(), mByFile()
+{
+}
+
+int IconIndex::addFile(const string &file)
+{
+    auto found = mByFile.find(file);
+    if (found != mByFile.end()) {
+        struct stat st;
+        int64_t modified;
+        const Entry &entry = mEntries[found->second];
+        if (stat(file.c_str(), &st) == 0 && stampOf(st, modified) &&
+            modified == entry.mModified && uint64_t(st.st_size) == entry.mFileSize) {
+            return SimpleIcon::Error::NO_ERROR;
+        }
+    }
+
+    Entry entry;
+    int error = readEntry(file, entry);
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        return error;
+    }
+
+    if (found != mByFile.end()) {
+        mEntries[found->second] = std::move(entry);
+    } else {
+        mByFile.emplace(file, mEntries.size());
+        mEntries.push_back(std::move(entry));
+    }
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+bool IconIndex::addDirectory(const string &directory)
+{
+    SimpleIconBatch batch;
+    if (!batch.addDirectory(directory)) {
+        return false;
+    }
+    for (const string &file : batch.files()) {
+        addFile(file);
+    }
+    return true;
+}
+
+size_t IconIndex::prune()
+{
+    std::vector<Entry> kept;
+    kept.reserve(mEntries.size());
+    mByFile.clear();
+
+    for (Entry &entry : mEntries) {
+        struct stat st;
+        if (stat(entry.mFile.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            mByFile.emplace(entry.mFile, kept.size());
+            kept.push_back(std::move(entry));
+        }
+    }
+
+    size_t dropped = mEntries.size() - kept.size();
+    mEntries.swap(kept);
+    return dropped;
+}
+
+bool IconIndex::load(const string &file)
+{
+    mEntries.clear();
+    mByFile.clear();
+
+    MappedFile mapped(file);
+    if (!mapped.isOpen()) {
+        std::cerr << "Unable to open index '" << file << "'" << endl;
+        return false;
+    }
+
+    string_view content = mapped.view();
+    if (content.size() < INDEX_HEADER_SIZE ||
+        std::memcmp(content.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+        BinaryFormat::readLE<uint16_t>(content.data() + 4) != FORMAT_VERSION) {
+        std::cerr << "'" << file << "' is not an icon index" << endl;
+        return false;
+    }
+
+    const uint32_t count = BinaryFormat::readLE<uint32_t>(content.data() + 8);
+    size_t pos = INDEX_HEADER_SIZE;
+    mEntries.reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (content.size() - pos < RECORD_SIZE) {
+            break;
+        }
+        const char *record = content.data() + pos;
+        Entry entry;
+        entry.mFileVersion = int(BinaryFormat::readLE<uint32_t>(record));
+        entry.mWidth = int(BinaryFormat::readLE<uint32_t>(record + 4));
+        entry.mHeight = int(BinaryFormat::readLE<uint32_t>(record + 8));
+        entry.mFlags = BinaryFormat::readLE<uint32_t>(record + 12);
+        entry.mOffset = BinaryFormat::readLE<uint64_t>(record + 16);
+        entry.mPayloadLength = BinaryFormat::readLE<uint64_t>(record + 24);
+        entry.mFingerprint = BinaryFormat::readLE<uint64_t>(record + 32);
+        entry.mModified = int64_t(BinaryFormat::readLE<uint64_t>(record + 40));
+        entry.mFileSize = BinaryFormat::readLE<uint64_t>(record + 48);
+        const size_t pathLength = BinaryFormat::readLE<uint32_t>(record + 56);
+        const size_t nameLength = BinaryFormat::readLE<uint32_t>(record + 60);
+        pos += RECORD_SIZE;
+
+        if (content.size() - pos < pathLength ||
+            content.size() - pos - pathLength < nameLength) {
+            break;
+        }
+        entry.mFile.assign(content.data() + pos, pathLength);
+        entry.mName.assign(content.data() + pos + pathLength, nameLength);
+        pos += pathLength + nameLength;
+
+        mByFile.emplace(entry.mFile, mEntries.size());
+        mEntries.push_back(std::move(entry));
+    }
+
+    if (mEntries.size() != count) {
+        std::cerr << "Icon index '" << file << "' is truncated" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool IconIndex::save(const string &file) const
+{
+    string content(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    BinaryFormat::appendLE<uint16_t>(content, FORMAT_VERSION);
+    BinaryFormat::appendLE<uint16_t>(content, 0);
+    BinaryFormat::appendLE<uint32_t>(content, uint32_t(mEntries.size()));
+
+    for (const Entry &entry : mEntries) {
+        BinaryFormat::appendLE<uint32_t>(content, uint32_t(entry.mFileVersion));
+        BinaryFormat::appendLE<uint32_t>(content, uint32_t(entry.mWidth));
+        BinaryFormat::appendLE<uint32_t>(content, uint32_t(entry.mHeight));
+        BinaryFormat::appendLE<uint32_t>(content, entry.mFlags);
+        BinaryFormat::appendLE<uint64_t>(content, entry.mOffset);
+        BinaryFormat::appendLE<uint64_t>(content, entry.mPayloadLength);
+        BinaryFormat::appendLE<uint64_t>(content, entry.mFingerprint);
+        BinaryFormat::appendLE<uint64_t>(content, uint64_t(entry.mModified));
+        BinaryFormat::appendLE<uint64_t>(content, entry.mFileSize);
+        BinaryFormat::appendLE<uint32_t>(content, uint32_t(entry.mFile.size()));
+        BinaryFormat::appendLE<uint32_t>(content, uint32_t(entry.mName.size()));
+        content += entry.mFile;
+        content += entry.mName;
+    }
+
+    return BinaryFormat::writeAll(file, content);
+}
+
+std::vector<const IconIndex::Entry *> IconIndex::find(const Query &query) const
+{
+    std::vector<const Entry *> found;
+    for (const Entry &entry : mEntries) {
+        if ((query.width && entry.mWidth != query.width) ||
+            (query.height && entry.mHeight != query.height) ||
+            (query.fileVersion && entry.mFileVersion != query.fileVersion) ||
+            (!query.name.empty() && !matchName(query.name, entry.mName))) {
+            continue;
+        }
+        found.push_back(&entry);
+    }
+    return found;
+}
+
+bool IconIndex::matchName(string_view pattern, string_view name)
+{
+    // Iterative glob matching, backtracking to the last '*' only.
+    size_t p = 0, n = 0;
+    size_t star = string_view::npos, resume = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' ||
+            std::tolower(static_cast<unsigned char>(pattern[p])) ==
+            std::tolower(static_cast<unsigned char>(name[n])))) {
+            ++p;
+            ++n;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = n;
+        } else if (star != string_view::npos) {
+            p = star + 1;
+            n = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+// GETTER
+
+const std::vector<IconIndex::Entry> & IconIndex::entries() const
+{
+    return mEntries;
+}
+
+size_t IconIndex::size() const
+{
+    return mEntries.size();
+}
+
+int IconIndex::readEntry(const string &file, Entry &entry)
+{
+    int fd = ::open(file.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !stampOf(st, entry.mModified)) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        std::cerr << "Unable to open file '" << file << "'" << endl;
+        return SimpleIcon::Error::FILE_NOT_READABLE;
+    }
+
+    entry.mFile = file;
+    entry.mFileSize = uint64_t(st.st_size);
+
+    string prefix;
+    int error = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    readPrefix(fd, entry.mFileSize, BinaryFormat::HEADER_SIZE, prefix);
+
+    if (BinaryFormat::isBinary(prefix)) {
+        // Newer headers, e.g. of atlas files, are longer than HEADER_SIZE.
+        if (prefix.size() >= 8) {
+            const size_t headerSize = BinaryFormat::readLE<uint16_t>(prefix.data() + 6);
+            readPrefix(fd, entry.mFileSize, std::max<size_t>(BinaryFormat::HEADER_SIZE, headerSize), prefix);
+        }
+        BinaryFormat::Header header;
+        error = BinaryFormat::readHeader(prefix, entry.mFileSize, header);
+        if (error == SimpleIcon::Error::NO_ERROR && header.fileVersion > 4) {
+            std::cerr << "Unsupported file version " << header.fileVersion << endl;
+            error = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+        }
+        if (error == SimpleIcon::Error::NO_ERROR) {
+            readPrefix(fd, entry.mFileSize, header.nameOffset + header.nameLength, prefix);
+            entry.mName = string(BinaryFormat::name(prefix, header));
+            entry.mFileVersion = int(header.fileVersion);
+            entry.mWidth = int(header.width);
+            entry.mHeight = int(header.height);
+            entry.mFlags = Entry::BINARY;
+            entry.mOffset = header.pixelOffset;
+            entry.mPayloadLength = header.pixelLength;
+            entry.mFingerprint = header.checksum;
+        }
+    } else {
+        // Collect the header without line breaks up to the third delimiter.
+        string header;
+        size_t pos = 0;
+        size_t fieldStart = 0;
+        int delimiters = 0;
+        while (delimiters < 3 && header.size() < MAX_HEADER_LENGTH) {
+            if (pos == prefix.size()) {
+                readPrefix(fd, entry.mFileSize, prefix.size() + READ_STEP, prefix);
+                if (pos == prefix.size()) {
+                    break;
+                }
+            }
+            const char c = prefix[pos++];
+            if (c == '\n' || c == '\r') {
+                continue;
+            }
+            header += c;
+            if (header.size() - fieldStart >= SimpleIcon::DELIM.size() &&
+                header.compare(header.size() - SimpleIcon::DELIM.size(),
+                               SimpleIcon::DELIM.size(), SimpleIcon::DELIM) == 0) {
+                ++delimiters;
+                fieldStart = header.size();
+            }
+        }
+
+        SimpleIcon::Header fields;
+        if (delimiters == 3) {
+            error = SimpleIcon::parseHeaderFields(header, fields);
+        }
+        if (error == SimpleIcon::Error::NO_ERROR && fields.fileVersion > 4) {
+            std::cerr << "Unsupported file version " << fields.fileVersion << endl;
+            error = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+        }
+        if (error == SimpleIcon::Error::NO_ERROR) {
+            entry.mName = string(fields.name);
+            entry.mFileVersion = fields.fileVersion;
+            entry.mWidth = fields.width;
+            entry.mHeight = fields.height;
+            entry.mOffset = pos;
+            entry.mPayloadLength = entry.mFileSize - pos;
+            entry.mFingerprint = Bitplane::hashBytes(header.data(), header.size());
+        }
+    }
+
+    ::close(fd);
+    return error;
+}
@@ -0,0 +1,181 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ICONINDEX_H
+#define ICONINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+using std::string;
+using std::string_view;
+
+/**
+ * Catalog of an icon library built from the file headers only.
+ *
+ * For text files only the bytes up to the third field delimiter are read,
+ * for binary files the fixed header and the name; no pixel is decoded.
+ * The index can be saved to and loaded from a file. Adding a file whose
+ * modification time and size did not change since it was indexed reuses
+ * the existing entry, so updating the index of a large tree is cheap.
+ *
+ * Index file layout, all integers little endian:
+ *
+ *     "\x89SIX", u16 format version, u16 0, u32 entry count, then per
+ *     entry: u32 file version, u32 width, u32 height, u32 flags,
+ *     u64 payload offset, u64 payload length, u64 fingerprint (see
+ *     Entry::fingerprint()), i64 modification time in ns, u64 file size,
+ *     u32 path length, u32 name length, path, name.
+ */
+class IconIndex
+{
+public:
+    /** Newest index file version understood by this reader. */
+    static const uint16_t FORMAT_VERSION = 1;
+
+    /**
+     * Indexed file. The accessors mirror those of SimpleIcon.
+     */
+    class Entry
+    {
+    public:
+        /** Entry flag: the file is in BinaryFormat. */
+        static const uint32_t BINARY = 1;
+
+        Entry();
+
+        const string & file() const { return mFile; }
+        const string & name() const { return mName; }
+        int fileVersion() const { return mFileVersion; }
+        int width() const { return mWidth; }
+        int height() const { return mHeight; }
+        bool isBinary() const { return (mFlags & BINARY) != 0; }
+
+        /**
+         * Byte offset of the pixel data (text payload or binary pixel
+         * section) in the file.
+         */
+        uint64_t offset() const { return mOffset; }
+        uint64_t payloadLength() const { return mPayloadLength; }
+
+        /**
+         * Fingerprint of the header the entry was read from: the pixel
+         * checksum stored in binary files, a hash of name, version and
+         * size for text files. Text files are indexed without reading
+         * their pixels, so two of them differing only in pixels have the
+         * same fingerprint.
+         */
+        uint64_t fingerprint() const { return mFingerprint; }
+
+    private:
+        friend class IconIndex;
+
+        string mFile;
+        string mName;
+        int mFileVersion;
+        int mWidth;
+        int mHeight;
+        uint32_t mFlags;
+        uint64_t mOffset;
+        uint64_t mPayloadLength;
+        uint64_t mFingerprint;
+        int64_t mModified;
+        uint64_t mFileSize;
+    };
+
+    /**
+     * Search criteria, unset criteria match everything.
+     */
+    struct Query
+    {
+        string name;        ///< glob pattern with * and ?, case insensitive
+        int width = 0;
+        int height = 0;
+        int fileVersion = 0;
+    };
+
+    /**
+     * Construct an empty index.
+     */
+    IconIndex();
+
+    /**
+     * Index a single file, replacing an outdated entry for it.
+     * @param file Path of the image datafile
+     * @return Some value from SimpleIcon::Error
+     */
+    int addFile(const string &file);
+
+    /**
+     * Index all regular files below a directory. Files that cannot be
+     * read as icons are skipped.
+     * @param directory Directory to scan
+     * @return false if the directory could not be read
+     */
+    bool addDirectory(const string &directory);
+
+    /**
+     * Drop entries whose files no longer exist.
+     * @return Number of dropped entries
+     */
+    size_t prune();
+
+    /**
+     * Replace the content with an index file.
+     * @param file Path of the index file
+     * @return true if the file was read completely
+     */
+    bool load(const string &file);
+
+    /**
+     * Write the index with a single write call.
+     * @param file Path of the index file, an existing file is replaced
+     * @return true if the file was written completely
+     */
+    bool save(const string &file) const;
+
+    /**
+     * Entries matching a query, in index order.
+     */
+    std::vector<const Entry *> find(const Query &query) const;
+
+    /**
+     * Case insensitive glob match supporting * and ?.
+     */
+    static bool matchName(string_view pattern, string_view name);
+
+    // GETTER
+    const std::vector<Entry> & entries() const;
+    size_t size() const;
+
+private:
+    std::vector<Entry> mEntries;
+    std::unordered_map<string, size_t> mByFile;
+
+    static int readEntry(const string &file, Entry &entry);
+};
+
+#endif
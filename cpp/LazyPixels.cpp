@@ -0,0 +1,174 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "LazyPixels.h"
+#include "PixelDecoder.h"
+#include "SimpleIconStats.h"
+
+#include <cstring>
+#include <utility>
+
+#include <iostream>
+using std::endl;
+
+LazyPixels::LazyPixels(std::shared_ptr<const void> owner, std::string_view payload,
+                       int fileVersion, int width, int height) :
+    mMutex(), mOwner(std::move(owner)), mPayload(payload),
+    mFileVersion(fileVersion), mWidth(width), mHeight(height),
+    mStride(Bitplane::strideFor(width)), mCache(), mCachedRow(), mLastUse(),
+    mClock(0), mRowsDecoded(0), mPixels(), mMaterialized(false)
+{
+    for (int i = 0; i < CACHE_ROWS; ++i) {
+        mCachedRow[i] = -1;
+    }
+}
+
+bool LazyPixels::pixel(int x, int y) const
+{
+    if (mMaterialized.load(std::memory_order_acquire)) {
+        return mPixels.get(x, y);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mMaterialized.load(std::memory_order_relaxed)) {
+        return mPixels.get(x, y);
+    }
+    return (cachedRow(y)[x >> 6] >> (x & 63)) & 1;
+}
+
+void LazyPixels::readRow(int y, uint64_t *out) const
+{
+    const size_t bytes = size_t(mStride) * sizeof(uint64_t);
+    if (mMaterialized.load(std::memory_order_acquire)) {
+        std::memcpy(out, static_cast<const Bitplane &>(mPixels).row(y), bytes);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mMaterialized.load(std::memory_order_relaxed)) {
+        std::memcpy(out, static_cast<const Bitplane &>(mPixels).row(y), bytes);
+    } else {
+        std::memcpy(out, cachedRow(y), bytes);
+    }
+}
+
+const Bitplane & LazyPixels::materialize() const
+{
+    if (mMaterialized.load(std::memory_order_acquire)) {
+        return mPixels;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mMaterialized.load(std::memory_order_relaxed)) {
+        return mPixels;
+    }
+    if (!mPixels.reset(mWidth, mHeight)) {
+        std::cerr << "Illegal image size" << endl;
+        return mPixels;
+    }
+
+    SIMPLEICON_STAGE(DECODE, mPayload.size());
+    if (mFileVersion == 1) {
+        PixelDecoder::decodeV1(mPayload.data(), mPayload.size(), mPixels);
+    } else {
+        PixelDecoder::decodeV2(mPayload.data(), mPayload.size(), mPixels);
+    }
+    mRowsDecoded += size_t(mHeight);
+
+    // The payload and the row cache are not needed any more.
+    mOwner.reset();
+    mPayload = std::string_view();
+    std::vector<uint64_t>().swap(mCache);
+    mMaterialized.store(true, std::memory_order_release);
+    return mPixels;
+}
+
+bool LazyPixels::isMaterialized() const
+{
+    return mMaterialized.load(std::memory_order_acquire);
+}
+
+Thumbnail LazyPixels::thumbnail(int factor) const
+{
+    if (mMaterialized.load(std::memory_order_acquire)) {
+        return Thumbnail::fromBitplane(mPixels, factor);
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mMaterialized.load(std::memory_order_relaxed)) {
+        return Thumbnail::fromBitplane(mPixels, factor);
+    }
+    // Holding the owner keeps the payload valid without the lock.
+    const std::shared_ptr<const void> owner = mOwner;
+    const std::string_view payload = mPayload;
+    lock.unlock();
+
+    SIMPLEICON_STAGE(DECODE, payload.size());
+    if (mFileVersion == 2) {
+        return Thumbnail::fromV2(payload.data(), payload.size(), mWidth, mHeight, factor);
+    }
+    Thumbnail thumbnail(mWidth, mHeight, factor);
+    std::vector<uint64_t> row(static_cast<size_t>(mStride));
+    for (int y = 0; y < mHeight; ++y) {
+        PixelDecoder::decodeRowV1(payload.data(), payload.size(), mWidth, y, row.data());
+        thumbnail.addRow(y, row.data());
+    }
+    return thumbnail;
+}
+
+size_t LazyPixels::rowsDecoded() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRowsDecoded;
+}
+
+const uint64_t * LazyPixels::cachedRow(int y) const
+{
+    int slot = 0;
+    for (int i = 0; i < CACHE_ROWS; ++i) {
+        if (mCachedRow[i] == y) {
+            mLastUse[i] = ++mClock;
+            return mCache.data() + size_t(i) * size_t(mStride);
+        }
+        if (mLastUse[i] < mLastUse[slot]) {
+            slot = i;
+        }
+    }
+
+    if (mCache.empty()) {
+        mCache.resize(size_t(CACHE_ROWS) * size_t(mStride));
+    }
+    uint64_t *row = mCache.data() + size_t(slot) * size_t(mStride);
+    {
+        SIMPLEICON_STAGE(DECODE, size_t(mWidth));
+        if (mFileVersion == 1) {
+            PixelDecoder::decodeRowV1(mPayload.data(), mPayload.size(), mWidth, y, row);
+        } else {
+            PixelDecoder::decodeRowV2(mPayload.data(), mPayload.size(), mWidth, mHeight, y, row);
+        }
+    }
+    mCachedRow[slot] = y;
+    mLastUse[slot] = ++mClock;
+    ++mRowsDecoded;
+    return row;
+}
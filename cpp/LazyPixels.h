@@ -0,0 +1,126 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LAZYPIXELS_H
+#define LAZYPIXELS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "Bitplane.h"
+#include "Thumbnail.h"
+
+/**
+ * Pixels of a version 1 or 2 payload that are decoded only when accessed.
+ *
+ * Single pixels and rows are decoded from the raw payload on first use and
+ * kept in a small cache of recently used rows, so touching a few rows
+ * costs only those rows. materialize() decodes the whole image once when
+ * it is needed after all (rendering, saving); afterwards the payload is no
+ * longer referenced. All methods may be called from several threads.
+ */
+class LazyPixels
+{
+public:
+    /** Number of decoded rows kept in the cache. */
+    static const int CACHE_ROWS = 16;
+
+    /**
+     * Construct lazy pixels over a payload.
+     * @param owner Keeps the memory of the payload alive, may be empty if
+     * the caller guarantees that itself
+     * @param payload Data field of a version 1 or 2 file
+     * @param fileVersion 1 or 2
+     * @param width Image width, > 0
+     * @param height Image height, > 0
+     */
+    LazyPixels(std::shared_ptr<const void> owner, std::string_view payload,
+               int fileVersion, int width, int height);
+
+    LazyPixels(const LazyPixels &) = delete;
+    LazyPixels & operator=(const LazyPixels &) = delete;
+
+    /**
+     * Read a single pixel, decoding its row if it is not cached.
+     */
+    bool pixel(int x, int y) const;
+
+    /**
+     * Copy a row in Bitplane layout.
+     * @param y Row to read
+     * @param out Receives Bitplane::strideFor(width) words
+     */
+    void readRow(int y, uint64_t *out) const;
+
+    /**
+     * Decode the whole image if that has not happened yet.
+     * @return The pixels, empty if they could not be allocated; the
+     * payload is kept then and rows can still be read
+     */
+    const Bitplane & materialize() const;
+
+    bool isMaterialized() const;
+
+    /**
+     * Downscale the image without materializing it: version 2 payloads
+     * are counted straight from their column blocks, version 1 payloads
+     * row by row, bypassing the row cache.
+     * @param factor Downscaling factor
+     */
+    Thumbnail thumbnail(int factor) const;
+
+    /**
+     * Number of row decodes so far, cache misses included.
+     */
+    size_t rowsDecoded() const;
+
+private:
+    mutable std::mutex mMutex;
+    mutable std::shared_ptr<const void> mOwner;
+    mutable std::string_view mPayload;
+    int mFileVersion;
+    int mWidth;
+    int mHeight;
+    int mStride;
+
+    mutable std::vector<uint64_t> mCache;   ///< CACHE_ROWS rows of mStride words
+    mutable int mCachedRow[CACHE_ROWS];
+    mutable uint64_t mLastUse[CACHE_ROWS];
+    mutable uint64_t mClock;
+    mutable size_t mRowsDecoded;
+
+    mutable Bitplane mPixels;
+    mutable std::atomic<bool> mMaterialized;
+
+    /**
+     * Cached row, decoded on a miss. Call with mMutex held.
+     */
+    const uint64_t * cachedRow(int y) const;
+};
+
+#endif
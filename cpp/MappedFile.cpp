@@ -0,0 +1,115 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() :
+    mAddress(0), mSize(0), mOpen(false), mBuffer()
+{
+}
+
+MappedFile::MappedFile(const string &file) :
+    MappedFile()
+{
+    open(file);
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const string &file)
+{
+    close();
+
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        mSize = size_t(st.st_size);
+        if (mSize == 0) {
+            mOpen = true;
+        } else {
+            void *address = mmap(0, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, mSize, MADV_SEQUENTIAL);
+                mAddress = address;
+                mOpen = true;
+            }
+        }
+    }
+
+    // Not mappable: fall back to reading everything into mBuffer.
+    if (!mOpen) {
+        char chunk[65536];
+        ssize_t count;
+        while ((count = read(fd, chunk, sizeof(chunk))) > 0) {
+            mBuffer.append(chunk, size_t(count));
+        }
+        mSize = mBuffer.size();
+        mOpen = (count == 0);
+    }
+
+    ::close(fd);
+    return mOpen;
+}
+
+void MappedFile::close()
+{
+    if (mAddress) {
+        munmap(mAddress, mSize);
+    }
+    mAddress = 0;
+    mSize = 0;
+    mOpen = false;
+    mBuffer.clear();
+}
+
+bool MappedFile::isOpen() const
+{
+    return mOpen;
+}
+
+const char * MappedFile::data() const
+{
+    return mAddress ? static_cast<const char *>(mAddress) : mBuffer.data();
+}
+
+size_t MappedFile::size() const
+{
+    return mSize;
+}
+
+std::string_view MappedFile::view() const
+{
+    return std::string_view(data(), mSize);
+}
@@ -0,0 +1,82 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+using std::string;
+
+/**
+ * Read-only view of a whole file, memory mapped where possible.
+ *
+ * Regular files are mapped with mmap so their content can be parsed in
+ * place. Anything that cannot be mapped (pipes, character devices) is
+ * read into an internal buffer instead, behind the same interface.
+ */
+class MappedFile
+{
+public:
+    /**
+     * Construct a closed MappedFile.
+     */
+    MappedFile();
+
+    /**
+     * Construct a MappedFile and open the specified file.
+     * @param file Path of the file to map
+     */
+    explicit MappedFile(const string &file);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    /**
+     * Map the specified file, closing any previously opened one.
+     * @param file Path of the file to map
+     * @return true if the file content is available
+     */
+    bool open(const string &file);
+
+    /**
+     * Unmap the file and release all resources.
+     */
+    void close();
+
+    bool isOpen() const;
+    const char * data() const;
+    size_t size() const;
+    std::string_view view() const;
+
+private:
+    void *mAddress;
+    size_t mSize;
+    bool mOpen;
+    string mBuffer;
+};
+
+#endif
@@ -0,0 +1,472 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PixelDecoder.h"
+#include "ThreadPool.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLEICON_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef uint64_t (*Pack64)(const char *);
+typedef void (*Transpose8)(const uint64_t *in, uint64_t *out);
+
+uint64_t lowMask(int count)
+{
+    return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+}
+
+uint64_t pack64Scalar(const char *data)
+{
+    return PixelDecoder::packScalar(data, 64);
+}
+
+/**
+ * Transpose an 8x8 byte matrix: byte k of out[j] = byte j of in[k].
+ */
+void transpose8Scalar(const uint64_t *in, uint64_t *out)
+{
+    for (int k = 0; k < 8; ++k) {
+        uint64_t word = 0;
+        for (int j = 0; j < 8; ++j) {
+            word |= ((in[j] >> (8 * k)) & 0xff) << (8 * j);
+        }
+        out[k] = word;
+    }
+}
+
+#ifdef SIMPLEICON_X86
+__attribute__((target("sse2")))
+void transpose8Sse2(const uint64_t *in, uint64_t *out)
+{
+    __m128i a[8];
+    for (int j = 0; j < 8; ++j) {
+        a[j] = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + j));
+    }
+
+    __m128i t0 = _mm_unpacklo_epi8(a[0], a[1]);
+    __m128i t1 = _mm_unpacklo_epi8(a[2], a[3]);
+    __m128i t2 = _mm_unpacklo_epi8(a[4], a[5]);
+    __m128i t3 = _mm_unpacklo_epi8(a[6], a[7]);
+
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+    __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+    __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+
+    __m128i *dst = reinterpret_cast<__m128i *>(out);
+    _mm_storeu_si128(dst + 0, _mm_unpacklo_epi32(u0, u2));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi32(u0, u2));
+    _mm_storeu_si128(dst + 2, _mm_unpacklo_epi32(u1, u3));
+    _mm_storeu_si128(dst + 3, _mm_unpackhi_epi32(u1, u3));
+}
+
+__attribute__((target("sse2")))
+uint64_t pack64Sse2(const char *data)
+{
+    const __m128i one = _mm_set1_epi8('1');
+    uint64_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * i));
+        uint32_t mask = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, one)));
+        bits |= uint64_t(mask) << (16 * i);
+    }
+    return bits;
+}
+
+__attribute__((target("avx2")))
+uint64_t pack64Avx2(const char *data)
+{
+    const __m256i one = _mm256_set1_epi8('1');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 32));
+    uint32_t maskLo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, one)));
+    uint32_t maskHi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, one)));
+    return uint64_t(maskLo) | (uint64_t(maskHi) << 32);
+}
+#endif
+
+Pack64 packerFor(PixelDecoder::Isa isa)
+{
+    switch (isa) {
+#ifdef SIMPLEICON_X86
+    case PixelDecoder::AVX2:
+        return pack64Avx2;
+    case PixelDecoder::SSE2:
+        return pack64Sse2;
+#endif
+    default:
+        return pack64Scalar;
+    }
+}
+
+Transpose8 transposerFor(PixelDecoder::Isa isa)
+{
+#ifdef SIMPLEICON_X86
+    if (isa >= PixelDecoder::SSE2) {
+        return transpose8Sse2;
+    }
+#endif
+    (void) isa;
+    return transpose8Scalar;
+}
+
+PixelDecoder::Isa sIsa = PixelDecoder::detectedIsa();
+Pack64 sPack64 = packerFor(sIsa);
+Transpose8 sTranspose8 = transposerFor(sIsa);
+size_t sParallelThreshold = PixelDecoder::DEFAULT_PARALLEL_THRESHOLD;
+
+/** Pixels decoded per parallel task, enough to amortize scheduling. */
+const size_t TASK_PIXELS = 1 << 18;
+
+/**
+ * Pixel by pixel version 2 decoding for payloads shorter than the image.
+ */
+void decodeV2Truncated(const char *data, size_t length, Bitplane &pixels)
+{
+    size_t charPos = 0;
+    for (int offset = 0; offset < pixels.width(); offset += 8) {
+        for (int row = 0; row < pixels.height(); ++row) {
+            for (int col = offset; col < offset + 8 && col < pixels.width(); ++col) {
+                if (charPos >= length) {
+                    return;
+                }
+                if (data[charPos++] == '1') {
+                    pixels.set(col, row, true);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Decode one row of a version 1 payload into stride words. Words past the
+ * end of the payload are left untouched.
+ */
+void decodeV1Row(const char *data, size_t length, int width, int row, uint64_t *dst)
+{
+    const int stride = Bitplane::strideFor(width);
+    const Pack64 pack = sPack64;
+    size_t start = size_t(row) * size_t(width);
+    if (start >= length) {
+        return;
+    }
+
+    const char *src = data + start;
+    size_t avail = length - start;
+
+    for (int word = 0; word < stride; ++word) {
+        size_t offset = size_t(word) * 64;
+        if (offset >= avail) {
+            break;
+        }
+
+        int count = width - word * 64;
+        if (count > 64) {
+            count = 64;
+        }
+
+        // Full 64 byte loads are fine as long as they stay inside the
+        // payload, even if they reach into the next row.
+        if (avail - offset >= 64) {
+            dst[word] = pack(src + offset) & lowMask(count);
+        } else {
+            if (size_t(count) > avail - offset) {
+                count = int(avail - offset);
+            }
+            dst[word] = PixelDecoder::packScalar(src + offset, count);
+        }
+    }
+}
+
+/**
+ * Decode rows [rowBegin, rowEnd) of a version 1 payload.
+ */
+void decodeV1Band(const char *data, size_t length, Bitplane &pixels,
+                  int rowBegin, int rowEnd)
+{
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        decodeV1Row(data, length, pixels.width(), row, pixels.row(row));
+    }
+}
+
+/**
+ * Decode rows [rowBegin, rowEnd) of a complete version 2 payload. rowBegin
+ * should be a multiple of 8 to get the most out of the transpose.
+ */
+void decodeV2Band(const char *data, Bitplane &pixels, int rowBegin, int rowEnd)
+{
+    const int width = pixels.width();
+    const int height = pixels.height();
+    const Pack64 pack = sPack64;
+    const Transpose8 transpose = sTranspose8;
+    const int fullBlocks = width / 8;
+    const int rest = width % 8;
+    const int fullRows = rowBegin + ((rowEnd - rowBegin) & ~7);
+    const size_t blockSize = size_t(8) * size_t(height);
+    int block = 0;
+
+    // Eight full blocks side by side form one bitplane word per row. Packing
+    // 64 digits of a block yields one byte for each of 8 rows, so 8 blocks
+    // x 8 rows is an 8x8 byte transpose away from 8 finished row words.
+    for (; block + 8 <= fullBlocks; block += 8) {
+        const char *src = data + size_t(block) * blockSize;
+        const int word = block / 8;
+        uint64_t in[8];
+        uint64_t out[8];
+
+        for (int row = rowBegin; row < fullRows; row += 8) {
+            for (int j = 0; j < 8; ++j) {
+                in[j] = pack(src + size_t(j) * blockSize + size_t(row) * 8);
+            }
+            transpose(in, out);
+            for (int k = 0; k < 8; ++k) {
+                pixels.row(row + k)[word] = out[k];
+            }
+        }
+        for (int row = fullRows; row < rowEnd; ++row) {
+            for (int j = 0; j < 8; ++j) {
+                pixels.orBlock(block + j, row,
+                               PixelDecoder::packScalar(src + size_t(j) * blockSize + size_t(row) * 8, 8));
+            }
+        }
+    }
+
+    // Remaining full blocks, still 8 rows per packed word.
+    for (; block < fullBlocks; ++block) {
+        const char *src = data + size_t(block) * blockSize;
+        int row = rowBegin;
+        for (; row < fullRows; row += 8) {
+            uint64_t bits = pack(src + size_t(row) * 8);
+            for (int k = 0; k < 8; ++k) {
+                pixels.orBlock(block, row + k, bits >> (8 * k));
+            }
+        }
+        for (; row < rowEnd; ++row) {
+            pixels.orBlock(block, row, PixelDecoder::packScalar(src + size_t(row) * 8, 8));
+        }
+    }
+
+    // The ragged last block holds only `rest` pixels per row.
+    if (rest) {
+        const char *src = data + size_t(fullBlocks) * blockSize;
+        for (int row = rowBegin; row < rowEnd; ++row) {
+            pixels.orBlock(fullBlocks, row, PixelDecoder::packScalar(src + size_t(row) * rest, rest));
+        }
+    }
+}
+
+size_t bandCount(const Bitplane &pixels, int bandRows)
+{
+    return (size_t(pixels.height()) + bandRows - 1) / bandRows;
+}
+
+int bandEnd(const Bitplane &pixels, size_t band, int bandRows)
+{
+    size_t end = (band + 1) * size_t(bandRows);
+    return end > size_t(pixels.height()) ? pixels.height() : int(end);
+}
+
+
+}
+
+void PixelDecoder::decodeV1(const char *data, size_t length, Bitplane &pixels)
+{
+    const int bandRows = rowsPerTask(pixels, 1);
+    if (bandRows == 0) {
+        decodeV1Band(data, length, pixels, 0, pixels.height());
+        return;
+    }
+
+    // Rows start at row * width in the payload, so bands of rows can be
+    // decoded independently.
+    ThreadPool::shared().parallelFor(bandCount(pixels, bandRows), [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            decodeV1Band(data, length, pixels, int(band) * bandRows,
+                         bandEnd(pixels, band, bandRows));
+        }
+    });
+}
+
+void PixelDecoder::decodeV2(const char *data, size_t length, Bitplane &pixels)
+{
+    if (length < size_t(pixels.width()) * size_t(pixels.height())) {
+        decodeV2Truncated(data, length, pixels);
+        return;
+    }
+
+    const int bandRows = rowsPerTask(pixels, 8);
+    if (bandRows == 0) {
+        decodeV2Band(data, pixels, 0, pixels.height());
+        return;
+    }
+
+    // Every column block holds the rows at row * blockWidth, so bands of 8
+    // rows across all blocks touch disjoint row words.
+    ThreadPool::shared().parallelFor(bandCount(pixels, bandRows), [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            decodeV2Band(data, pixels, int(band) * bandRows,
+                         bandEnd(pixels, band, bandRows));
+        }
+    });
+}
+
+void PixelDecoder::decodeRowV1(const char *data, size_t length, int width, int row,
+                               uint64_t *out)
+{
+    std::memset(out, 0, size_t(Bitplane::strideFor(width)) * sizeof(uint64_t));
+    decodeV1Row(data, length, width, row, out);
+}
+
+void PixelDecoder::decodeRowV2(const char *data, size_t length, int width, int height,
+                               int row, uint64_t *out)
+{
+    const Pack64 pack = sPack64;
+    const int fullBlocks = width / 8;
+    const int rest = width % 8;
+    const size_t blockSize = size_t(8) * size_t(height);
+
+    std::memset(out, 0, size_t(Bitplane::strideFor(width)) * sizeof(uint64_t));
+
+    // The 8 digits of a row in 8 neighbouring blocks gathered side by side
+    // are exactly the 64 digits of one row word.
+    for (int block = 0; block < fullBlocks; block += 8) {
+        char digits[64];
+        std::memset(digits, '0', sizeof(digits));
+        for (int j = 0; j < 8 && block + j < fullBlocks; ++j) {
+            size_t offset = size_t(block + j) * blockSize + size_t(row) * 8;
+            if (offset < length) {
+                std::memcpy(digits + j * 8, data + offset, length - offset < 8 ? length - offset : 8);
+            }
+        }
+        out[block / 8] = pack(digits);
+    }
+
+    if (rest) {
+        size_t offset = size_t(fullBlocks) * blockSize + size_t(row) * size_t(rest);
+        if (offset < length) {
+            int count = length - offset < size_t(rest) ? int(length - offset) : rest;
+            out[fullBlocks / 8] |= PixelDecoder::packScalar(data + offset, count)
+                                   << ((fullBlocks & 7) * 8);
+        }
+    }
+}
+
+void PixelDecoder::transpose8(const uint64_t *in, uint64_t *out)
+{
+    sTranspose8(in, out);
+}
+
+uint64_t PixelDecoder::pack64(const char *data)
+{
+    return sPack64(data);
+}
+
+uint64_t PixelDecoder::packScalar(const char *data, int count)
+{
+    uint64_t bits = 0;
+    for (int i = 0; i < count; ++i) {
+        bits |= uint64_t(data[i] == '1') << i;
+    }
+    return bits;
+}
+
+PixelDecoder::Isa PixelDecoder::detectedIsa()
+{
+#ifdef SIMPLEICON_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#endif
+    return SCALAR;
+}
+
+PixelDecoder::Isa PixelDecoder::isa()
+{
+    return sIsa;
+}
+
+bool PixelDecoder::usePopcnt()
+{
+#ifdef SIMPLEICON_X86
+    static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("popcnt"));
+    return supported && sIsa != SCALAR;
+#else
+    return false;
+#endif
+}
+
+PixelDecoder::Isa PixelDecoder::setIsa(Isa isa)
+{
+    Isa best = detectedIsa();
+    sIsa = (isa > best) ? best : isa;
+    sPack64 = packerFor(sIsa);
+    sTranspose8 = transposerFor(sIsa);
+    return sIsa;
+}
+
+size_t PixelDecoder::parallelThreshold()
+{
+    return sParallelThreshold;
+}
+
+void PixelDecoder::setParallelThreshold(size_t pixels)
+{
+    sParallelThreshold = pixels;
+}
+
+int PixelDecoder::rowsPerTask(const Bitplane &pixels, int align)
+{
+    size_t area = size_t(pixels.width()) * size_t(pixels.height());
+    if (area < sParallelThreshold || ThreadPool::shared().size() < 2) {
+        return 0;
+    }
+
+    size_t rows = TASK_PIXELS / size_t(pixels.width());
+    rows = (rows + align - 1) / align * align;
+    if (rows == 0) {
+        rows = align;
+    }
+    return rows >= size_t(pixels.height()) ? 0 : int(rows);
+}
+
+const char * PixelDecoder::isaName(Isa isa)
+{
+    switch (isa) {
+    case AVX2:
+        return "avx2";
+    case SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
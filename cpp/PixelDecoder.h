@@ -0,0 +1,182 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PIXELDECODER_H
+#define PIXELDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bitplane.h"
+
+/**
+ * Kernels converting the '0'/'1' payload of an image datafile into packed
+ * Bitplane rows.
+ *
+ * The hot loop packs 64 ASCII digits into one 64 bit word. On x86 it is
+ * vectorized with SSE2 or AVX2 (compare against '1' and movemask); the
+ * variant is picked once at startup from the CPU features, with a portable
+ * scalar loop as fallback. Version 2 payloads additionally go through an
+ * 8x8 byte transpose (SSE2 shuffles on x86) to turn 8 pixel column blocks
+ * back into rows.
+ *
+ * Images of at least parallelThreshold() pixels are split into bands of
+ * rows that are decoded on ThreadPool::shared(); smaller images, and
+ * decoding from inside a pool task, stay serial.
+ */
+class PixelDecoder
+{
+public:
+    /**
+     * Instruction set used by the packing kernel.
+     */
+    enum Isa {
+        SCALAR = 0,
+        SSE2 = 1,
+        AVX2 = 2
+    };
+
+    /** Default for parallelThreshold(): 2 megapixels. */
+    static const size_t DEFAULT_PARALLEL_THRESHOLD = size_t(1) << 21;
+
+    /**
+     * Decode a version 1 payload (row after row) into pixels.
+     * The bitplane must already have the image dimensions and be cleared.
+     * A payload shorter than width * height leaves the rest of the pixels
+     * cleared.
+     * @param data Start of the data field
+     * @param length Length of the data field in bytes
+     * @param pixels Target bitplane
+     */
+    static void decodeV1(const char *data, size_t length, Bitplane &pixels);
+
+    /**
+     * Decode a version 2 payload (8 pixel wide column blocks) into pixels.
+     * Same preconditions and truncation behaviour as decodeV1().
+     * @param data Start of the data field
+     * @param length Length of the data field in bytes
+     * @param pixels Target bitplane
+     */
+    static void decodeV2(const char *data, size_t length, Bitplane &pixels);
+
+    /**
+     * Decode a single row of a version 1 payload, e.g. for lazy access.
+     * Pixels missing from a short payload are cleared.
+     * @param data Start of the data field
+     * @param length Length of the data field in bytes
+     * @param width Image width
+     * @param row Row to decode
+     * @param out Receives Bitplane::strideFor(width) words
+     */
+    static void decodeRowV1(const char *data, size_t length, int width, int row,
+                            uint64_t *out);
+
+    /**
+     * Decode a single row of a version 2 payload by gathering its 8 pixel
+     * runs from all column blocks. Same conventions as decodeRowV1().
+     * @param data Start of the data field
+     * @param length Length of the data field in bytes
+     * @param width Image width
+     * @param height Image height
+     * @param row Row to decode
+     * @param out Receives Bitplane::strideFor(width) words
+     */
+    static void decodeRowV2(const char *data, size_t length, int width, int height,
+                            int row, uint64_t *out);
+
+    /**
+     * Pack exactly 64 ASCII digits into a word, bit i set for data[i] == '1',
+     * using the currently selected instruction set.
+     * @param data First digit, 64 bytes must be readable
+     */
+    static uint64_t pack64(const char *data);
+
+    /**
+     * Pack up to 64 ASCII digits into a word, bit i set for data[i] == '1'.
+     * Always uses the scalar loop.
+     * @param data First digit
+     * @param count Number of digits to pack, at most 64
+     */
+    static uint64_t packScalar(const char *data, int count);
+
+    /**
+     * Transpose an 8x8 byte matrix, byte k of out[j] = byte j of in[k],
+     * using the currently selected instruction set. The transpose is its
+     * own inverse, so it also turns rows back into column blocks.
+     */
+    static void transpose8(const uint64_t *in, uint64_t *out);
+
+    /**
+     * Best instruction set supported by the running CPU.
+     */
+    static Isa detectedIsa();
+
+    /**
+     * Instruction set currently used by the decoder.
+     */
+    static Isa isa();
+
+    /**
+     * Select the instruction set used by the decoder, e.g. to cross-check
+     * the vector kernels against the scalar one. Requests beyond what the
+     * CPU supports are lowered to detectedIsa().
+     * @param isa Requested instruction set
+     * @return The instruction set actually selected
+     */
+    static Isa setIsa(Isa isa);
+
+    /**
+     * Whether popcount kernels may use the POPCNT instruction: the CPU
+     * supports it and isa() is not SCALAR.
+     */
+    static bool usePopcnt();
+
+    /**
+     * Smallest image, in pixels, decoded by several threads.
+     */
+    static size_t parallelThreshold();
+
+    /**
+     * Set the smallest image, in pixels, decoded by several threads.
+     * @param pixels New threshold; 0 parallelizes everything above one
+     * task worth of rows, SIZE_MAX disables parallel decoding
+     */
+    static void setParallelThreshold(size_t pixels);
+
+    /**
+     * Rows per parallel task when an image is split into bands of rows,
+     * for decoding here and for PixelEncoder.
+     * @param pixels Image to split
+     * @param align The rows of a band are a multiple of this
+     * @return Rows per band, or 0 if the image is smaller than
+     * parallelThreshold() or would make a single band anyway
+     */
+    static int rowsPerTask(const Bitplane &pixels, int align);
+
+    /**
+     * Printable name of an instruction set.
+     */
+    static const char * isaName(Isa isa);
+};
+
+#endif
@@ -0,0 +1,248 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PixelEncoder.h"
+#include "PixelDecoder.h"
+#include "ThreadPool.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMPLEICON_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*Unpack64)(uint64_t bits, char *out);
+
+/**
+ * The 8 digits for every byte value, bit 0 first.
+ */
+struct DigitTable
+{
+    char digits[256][8];
+
+    constexpr DigitTable() : digits()
+    {
+        for (int value = 0; value < 256; ++value) {
+            for (int bit = 0; bit < 8; ++bit) {
+                digits[value][bit] = (value >> bit) & 1 ? '1' : '0';
+            }
+        }
+    }
+};
+
+constexpr DigitTable DIGIT_TABLE;
+
+void unpack64Scalar(uint64_t bits, char *out)
+{
+    for (int i = 0; i < 8; ++i) {
+        std::memcpy(out + 8 * i, DIGIT_TABLE.digits[(bits >> (8 * i)) & 0xff], 8);
+    }
+}
+
+#ifdef SIMPLEICON_X86
+__attribute__((target("sse2")))
+void unpack64Sse2(uint64_t bits, char *out)
+{
+    const __m128i select = _mm_set1_epi64x(int64_t(0x8040201008040201ULL));
+    const __m128i zero = _mm_set1_epi8('0');
+    for (int i = 0; i < 4; ++i) {
+        // Two bytes, each spread over 8 lanes.
+        __m128i v = _mm_cvtsi32_si128(int((bits >> (16 * i)) & 0xffff));
+        v = _mm_unpacklo_epi8(v, v);
+        v = _mm_unpacklo_epi16(v, v);
+        v = _mm_unpacklo_epi32(v, v);
+        // Set lanes become -1; '0' - (-1) is '1'.
+        __m128i set = _mm_cmpeq_epi8(_mm_and_si128(v, select), select);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16 * i), _mm_sub_epi8(zero, set));
+    }
+}
+
+__attribute__((target("avx2")))
+void unpack64Avx2(uint64_t bits, char *out)
+{
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_set1_epi64x(int64_t(0x8040201008040201ULL));
+    const __m256i zero = _mm256_set1_epi8('0');
+    for (int i = 0; i < 2; ++i) {
+        // Four bytes, each spread over 8 lanes.
+        __m256i v = _mm256_set1_epi32(int(uint32_t(bits >> (32 * i))));
+        v = _mm256_shuffle_epi8(v, spread);
+        __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 32 * i), _mm256_sub_epi8(zero, set));
+    }
+}
+#endif
+
+Unpack64 unpackerFor(PixelDecoder::Isa isa)
+{
+    switch (isa) {
+#ifdef SIMPLEICON_X86
+    case PixelDecoder::AVX2:
+        return unpack64Avx2;
+    case PixelDecoder::SSE2:
+        return unpack64Sse2;
+#endif
+    default:
+        return unpack64Scalar;
+    }
+}
+
+/**
+ * Byte `block` (8 pixels from column block * 8) of a row.
+ */
+unsigned byteOf(const Bitplane &pixels, int y, int block)
+{
+    return unsigned(pixels.row(y)[block >> 3] >> (8 * (block & 7))) & 0xff;
+}
+
+/**
+ * Encode rows [rowBegin, rowEnd) as version 1 payload.
+ */
+void encodeV1Band(const Bitplane &pixels, char *out, int rowBegin, int rowEnd)
+{
+    const Unpack64 unpack = unpackerFor(PixelDecoder::isa());
+    const int width = pixels.width();
+    const int fullWords = width / 64;
+    const int rest = width % 64;
+
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        const uint64_t *row = pixels.row(y);
+        char *dst = out + size_t(y) * size_t(width);
+        for (int word = 0; word < fullWords; ++word) {
+            unpack(row[word], dst + word * 64);
+        }
+        if (rest) {
+            char digits[64];
+            unpack(row[fullWords], digits);
+            std::memcpy(dst + fullWords * 64, digits, size_t(rest));
+        }
+    }
+}
+
+/**
+ * Encode rows [rowBegin, rowEnd) of all column blocks as version 2
+ * payload. rowBegin should be a multiple of 8.
+ */
+void encodeV2Band(const Bitplane &pixels, char *out, int rowBegin, int rowEnd)
+{
+    const Unpack64 unpack = unpackerFor(PixelDecoder::isa());
+    const int width = pixels.width();
+    const int height = pixels.height();
+    const int fullBlocks = width / 8;
+    const int rest = width % 8;
+    const int fullRows = rowBegin + ((rowEnd - rowBegin) & ~7);
+    const size_t blockSize = size_t(8) * size_t(height);
+    int block = 0;
+
+    // The inverse of PixelDecoder's V2 kernel: 8 rows of one word are 8
+    // rows x 8 blocks, transposed into 8 blocks x 8 rows, i.e. 64
+    // consecutive digits of each block.
+    for (; block + 8 <= fullBlocks; block += 8) {
+        char *dst = out + size_t(block) * blockSize;
+        const int word = block / 8;
+        uint64_t in[8];
+        uint64_t blocks[8];
+
+        for (int y = rowBegin; y < fullRows; y += 8) {
+            for (int k = 0; k < 8; ++k) {
+                in[k] = pixels.row(y + k)[word];
+            }
+            PixelDecoder::transpose8(in, blocks);
+            for (int j = 0; j < 8; ++j) {
+                unpack(blocks[j], dst + size_t(j) * blockSize + size_t(y) * 8);
+            }
+        }
+        for (int y = fullRows; y < rowEnd; ++y) {
+            for (int j = 0; j < 8; ++j) {
+                std::memcpy(dst + size_t(j) * blockSize + size_t(y) * 8,
+                            DIGIT_TABLE.digits[byteOf(pixels, y, block + j)], 8);
+            }
+        }
+    }
+
+    // Remaining full blocks, 8 rows gathered into one word.
+    for (; block < fullBlocks; ++block) {
+        char *dst = out + size_t(block) * blockSize;
+        int y = rowBegin;
+        for (; y < fullRows; y += 8) {
+            uint64_t bits = 0;
+            for (int k = 0; k < 8; ++k) {
+                bits |= uint64_t(byteOf(pixels, y + k, block)) << (8 * k);
+            }
+            unpack(bits, dst + size_t(y) * 8);
+        }
+        for (; y < rowEnd; ++y) {
+            std::memcpy(dst + size_t(y) * 8, DIGIT_TABLE.digits[byteOf(pixels, y, block)], 8);
+        }
+    }
+
+    // The last, narrower block.
+    if (rest) {
+        char *dst = out + size_t(fullBlocks) * blockSize;
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            std::memcpy(dst + size_t(y) * size_t(rest),
+                        DIGIT_TABLE.digits[byteOf(pixels, y, fullBlocks)], size_t(rest));
+        }
+    }
+}
+
+typedef void (*EncodeBand)(const Bitplane &, char *, int, int);
+
+void encode(const Bitplane &pixels, char *out, EncodeBand encodeBand, int align)
+{
+    const int bandRows = PixelDecoder::rowsPerTask(pixels, align);
+    if (bandRows == 0) {
+        encodeBand(pixels, out, 0, pixels.height());
+        return;
+    }
+
+    const size_t bands = (size_t(pixels.height()) + bandRows - 1) / bandRows;
+    ThreadPool::shared().parallelFor(bands, [&](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            const size_t last = (band + 1) * size_t(bandRows);
+            encodeBand(pixels, out, int(band) * bandRows,
+                       last > size_t(pixels.height()) ? pixels.height() : int(last));
+        }
+    });
+}
+
+}
+
+void PixelEncoder::encodeV1(const Bitplane &pixels, char *out)
+{
+    encode(pixels, out, encodeV1Band, 1);
+}
+
+void PixelEncoder::encodeV2(const Bitplane &pixels, char *out)
+{
+    encode(pixels, out, encodeV2Band, 8);
+}
+
+void PixelEncoder::unpack64(uint64_t bits, char *out)
+{
+    unpackerFor(PixelDecoder::isa())(bits, out);
+}
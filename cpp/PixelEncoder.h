@@ -0,0 +1,71 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PIXELENCODER_H
+#define PIXELENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bitplane.h"
+
+/**
+ * Kernels writing packed Bitplane rows as the '0'/'1' payload of an image
+ * datafile; the inverse of PixelDecoder.
+ *
+ * The hot loop expands one 64 bit word into 64 ASCII digits. On x86 it is
+ * vectorized with SSE2 or AVX2 (broadcast, mask each byte's bit, compare);
+ * the variant follows PixelDecoder::isa(). Version 2 payloads first go
+ * through the 8x8 byte transpose of PixelDecoder, which turns 8 row words
+ * back into 8 column blocks.
+ *
+ * Images of at least PixelDecoder::parallelThreshold() pixels are encoded
+ * in bands of rows on ThreadPool::shared().
+ */
+class PixelEncoder
+{
+public:
+    /**
+     * Encode pixels as a version 1 payload (row after row).
+     * @param pixels Image data
+     * @param out Receives width * height digits
+     */
+    static void encodeV1(const Bitplane &pixels, char *out);
+
+    /**
+     * Encode pixels as a version 2 payload (8 pixel wide column blocks).
+     * @param pixels Image data
+     * @param out Receives width * height digits
+     */
+    static void encodeV2(const Bitplane &pixels, char *out);
+
+    /**
+     * Expand a word into 64 ASCII digits, '1' for set bits, bit 0 first,
+     * using the currently selected instruction set.
+     * @param bits Pixels
+     * @param out Receives 64 digits
+     */
+    static void unpack64(uint64_t bits, char *out);
+};
+
+#endif
@@ -0,0 +1,118 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "RunLengthCodec.h"
+#include "SimpleIcon.h"
+
+#include <iostream>
+using std::endl;
+
+namespace {
+
+int illegal(const char *message)
+{
+    std::cerr << message << endl;
+    return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+}
+
+}
+
+int RunLengthCodec::decode(string_view payload, Bitplane &pixels)
+{
+    const char *pos = payload.data();
+    const char *end = pos + payload.size();
+    int row = 0;
+    int col = 0;
+    bool on = false;
+
+    while (pos < end) {
+        if (*pos == ROW_DELIM) {
+            if (++row >= pixels.height()) {
+                return illegal("Run length data has more rows than the image");
+            }
+            col = 0;
+            on = false;
+            ++pos;
+            continue;
+        }
+
+        long run = 0;
+        const char *digits = pos;
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            run = run * 10 + (*pos++ - '0');
+            if (run > pixels.width() - col) {
+                return illegal("Run length exceeds the image width");
+            }
+        }
+        if (pos == digits) {
+            return illegal("Illegal character in run length data");
+        }
+
+        if (on) {
+            pixels.fillRange(row, col, col + int(run));
+        }
+        col += int(run);
+        on = !on;
+
+        if (pos < end && *pos == RUN_DELIM) {
+            ++pos;
+        }
+    }
+
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+string RunLengthCodec::encode(const Bitplane &pixels)
+{
+    string payload;
+    size_t pendingRows = 0;
+
+    for (int row = 0; row < pixels.height(); ++row) {
+        // Row delimiters are only written once a non-empty row follows.
+        if (row > 0) {
+            ++pendingRows;
+        }
+        if (pixels.findNext(row, 0, true) >= pixels.width()) {
+            continue;
+        }
+        payload.append(pendingRows, ROW_DELIM);
+        pendingRows = 0;
+
+        int col = 0;
+        bool on = false;
+        while (col < pixels.width()) {
+            int next = pixels.findNext(row, col, !on);
+            if (!on && next >= pixels.width()) {
+                break;
+            }
+            if (col > 0 || on) {
+                payload += RUN_DELIM;
+            }
+            payload += std::to_string(next - col);
+            col = next;
+            on = !on;
+        }
+    }
+
+    return payload;
+}
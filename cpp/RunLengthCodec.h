@@ -0,0 +1,67 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RUNLENGTHCODEC_H
+#define RUNLENGTHCODEC_H
+
+#include <string>
+#include <string_view>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+
+/**
+ * Version 3 payloads: run length encoded rows.
+ *
+ * Rows are separated by '/'. Each row is a ',' separated list of decimal
+ * run lengths alternating between clear and set pixels, always starting
+ * with a (possibly empty) clear run. A trailing clear run and trailing
+ * empty rows are left out, so the 10x3 sword reads "2,1/0,10/2,1".
+ */
+class RunLengthCodec
+{
+public:
+    /** Separator between rows. */
+    static const char ROW_DELIM = '/';
+
+    /** Separator between runs of a row. */
+    static const char RUN_DELIM = ',';
+
+    /**
+     * Decode a version 3 payload.
+     * @param payload Data field of the file
+     * @param pixels Cleared bitplane of the image size
+     * @return Some value from SimpleIcon::Error
+     */
+    static int decode(string_view payload, Bitplane &pixels);
+
+    /**
+     * Encode an image as version 3 payload.
+     * @param pixels Image data
+     * @return Data field for the file
+     */
+    static string encode(const Bitplane &pixels);
+};
+
+#endif
@@ -0,0 +1,423 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SharedIconStore.h"
+#include "SimpleIcon.h"
+#include "StagedImages.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+
+#include <iostream>
+using std::endl;
+
+const char SharedIconStore::SEGMENT_MAGIC[8] = { 'S', 'I', 'M', 'P', 'L', 'S', 'H', 'M' };
+
+/**
+ * Content of the control segment.
+ */
+struct SharedIconStore::Control
+{
+    char magic[8];
+    std::atomic<uint64_t> generation;   ///< latest published, 0 for none
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The generation number is shared between processes");
+
+namespace {
+
+const char CONTROL_MAGIC[8] = { 'S', 'I', 'M', 'P', 'L', 'C', 'T', 'L' };
+
+const size_t HEADER_SIZE = 64;
+const size_t ICON_SIZE = 32;
+const size_t SLOT_SIZE = 4;
+
+/** Attempts to catch up with publish() unlinking the generation we saw. */
+const int ATTACH_ATTEMPTS = 8;
+
+template<typename T>
+T readAt(const char *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template<typename T>
+void writeAt(char *data, T value)
+{
+    std::memcpy(data, &value, sizeof(T));
+}
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+SharedIconStore::Generation::Generation(const char *base, size_t size) :
+    mBase(base), mSize(size), mNumber(0), mIconCount(0), mImageCount(0),
+    mSlotCount(0), mIcons(0), mSlots(0)
+{
+}
+
+SharedIconStore::Generation::~Generation()
+{
+    ::munmap(const_cast<char *>(mBase), mSize);
+}
+
+std::shared_ptr<const SharedIconStore::Generation>
+SharedIconStore::Generation::open(const string &segment, uint64_t number)
+{
+    int fd = ::shm_open(segment.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return std::shared_ptr<const Generation>();
+    }
+    struct stat st;
+    void *address = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && size_t(st.st_size) >= HEADER_SIZE) {
+        address = ::mmap(0, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return std::shared_ptr<const Generation>();
+    }
+
+    // From here on the Generation owns the mapping.
+    std::shared_ptr<Generation> generation(new Generation(static_cast<const char *>(address),
+                                                          size_t(st.st_size)));
+    const char *base = generation->mBase;
+    const size_t size = generation->mSize;
+    const uint32_t icons = readAt<uint32_t>(base + 24);
+    const uint32_t images = readAt<uint32_t>(base + 28);
+    const uint32_t slots = readAt<uint32_t>(base + 32);
+    if (std::memcmp(base, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0
+            || readAt<uint64_t>(base + 8) != number || readAt<uint64_t>(base + 16) != size
+            || slots <= icons || (slots & (slots - 1)) != 0
+            || HEADER_SIZE + uint64_t(icons) * ICON_SIZE + uint64_t(slots) * SLOT_SIZE > size) {
+        return std::shared_ptr<const Generation>();
+    }
+
+    const char *records = base + HEADER_SIZE;
+    for (uint32_t i = 0; i < icons; ++i) {
+        const char *icon = records + size_t(i) * ICON_SIZE;
+        const uint64_t nameOffset = readAt<uint64_t>(icon);
+        const uint32_t nameLength = readAt<uint32_t>(icon + 8);
+        const int32_t width = readAt<int32_t>(icon + 16);
+        const int32_t height = readAt<int32_t>(icon + 20);
+        const uint64_t pixelOffset = readAt<uint64_t>(icon + 24);
+        if (nameOffset > size || nameLength > size - nameOffset || width <= 0 || height <= 0
+                || pixelOffset % Bitplane::ALIGNMENT != 0 || pixelOffset > size
+                || uint64_t(Bitplane::strideFor(width)) * uint64_t(height) * sizeof(uint64_t)
+                   > size - pixelOffset) {
+            return std::shared_ptr<const Generation>();
+        }
+    }
+    const uint32_t *slot = reinterpret_cast<const uint32_t *>(records + size_t(icons) * ICON_SIZE);
+    uint32_t used = 0;
+    for (uint32_t s = 0; s < slots; ++s) {
+        if (slot[s] > icons) {
+            return std::shared_ptr<const Generation>();
+        }
+        used += slot[s] != 0;
+    }
+    if (used > icons) {
+        return std::shared_ptr<const Generation>();
+    }
+
+    generation->mNumber = number;
+    generation->mIconCount = icons;
+    generation->mImageCount = images;
+    generation->mSlotCount = slots;
+    generation->mIcons = records;
+    generation->mSlots = slot;
+    return generation;
+}
+
+bool SharedIconStore::Generation::find(string_view name, SimpleIcon &icon) const
+{
+    uint32_t s = uint32_t(StagedImages::hashName(name)) & (mSlotCount - 1);
+    // There is always a free slot, open() made sure of it.
+    while (mSlots[s]) {
+        if (this->name(mSlots[s] - 1) == name) {
+            return this->icon(mSlots[s] - 1, icon);
+        }
+        s = (s + 1) & (mSlotCount - 1);
+    }
+    return false;
+}
+
+bool SharedIconStore::Generation::icon(size_t index, SimpleIcon &icon) const
+{
+    if (index >= mIconCount) {
+        return false;
+    }
+
+    const char *record = mIcons + index * ICON_SIZE;
+    const uint64_t *words = reinterpret_cast<const uint64_t *>(mBase + readAt<uint64_t>(record + 24));
+    icon = SimpleIcon(string(name(index)), readAt<int32_t>(record + 12),
+                      Bitplane::view(words, readAt<int32_t>(record + 16),
+                                     readAt<int32_t>(record + 20), shared_from_this()));
+    return true;
+}
+
+string_view SharedIconStore::Generation::name(size_t index) const
+{
+    if (index >= mIconCount) {
+        return string_view();
+    }
+
+    const char *record = mIcons + index * ICON_SIZE;
+    return string_view(mBase + readAt<uint64_t>(record), readAt<uint32_t>(record + 8));
+}
+
+SharedIconStore::SharedIconStore(const string &name) :
+    mName(name), mStaged(),
+    mControl(0), mControlWritable(false), mCurrent()
+{
+}
+
+SharedIconStore::~SharedIconStore()
+{
+    unmapControl();
+}
+
+bool SharedIconStore::add(const SimpleIcon &icon, string_view name)
+{
+    return mStaged.add(icon, name);
+}
+
+uint64_t SharedIconStore::publish()
+{
+    if (!mapControl(true)) {
+        return 0;
+    }
+
+    // Layout, see the class documentation.
+    const std::vector<StagedImages::Icon> &icons = mStaged.icons();
+    const std::vector<Bitplane> &images = mStaged.images();
+    const std::vector<uint32_t> slots = mStaged.nameSlots();
+    size_t namesOffset = HEADER_SIZE + icons.size() * ICON_SIZE + slots.size() * SLOT_SIZE;
+    size_t offset = namesOffset;
+    for (const StagedImages::Icon &icon : icons) {
+        offset += icon.name.size();
+    }
+    std::vector<size_t> imageOffsets(images.size());
+    for (size_t image = 0; image < images.size(); ++image) {
+        offset = alignUp(offset, Bitplane::ALIGNMENT);
+        imageOffsets[image] = offset;
+        offset += images[image].sizeInBytes();
+    }
+    const size_t size = offset;
+
+    const uint64_t previous = mControl->generation.load(std::memory_order_acquire);
+    const uint64_t number = previous + 1;
+    const string segment = segmentName(number);
+
+    // A leftover of a publisher that died before switching over.
+    ::shm_unlink(segment.c_str());
+    int fd = ::shm_open(segment.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        std::cerr << "Unable to create shared memory '" << segment << "'" << endl;
+        return 0;
+    }
+    void *address = MAP_FAILED;
+    if (::ftruncate(fd, off_t(size)) == 0) {
+        address = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Unable to allocate " << size << " bytes of shared memory" << endl;
+        ::shm_unlink(segment.c_str());
+        return 0;
+    }
+
+    // The segment starts out zeroed, so are the free slots and reserved
+    // fields.
+    char *base = static_cast<char *>(address);
+    std::memcpy(base, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    writeAt<uint64_t>(base + 8, number);
+    writeAt<uint64_t>(base + 16, size);
+    writeAt<uint32_t>(base + 24, uint32_t(icons.size()));
+    writeAt<uint32_t>(base + 28, uint32_t(images.size()));
+    writeAt<uint32_t>(base + 32, uint32_t(slots.size()));
+
+    for (size_t i = 0; i < icons.size(); ++i) {
+        const StagedImages::Icon &icon = icons[i];
+        const Bitplane &pixels = images[icon.image];
+        char *record = base + HEADER_SIZE + i * ICON_SIZE;
+        writeAt<uint64_t>(record, namesOffset);
+        writeAt<uint32_t>(record + 8, uint32_t(icon.name.size()));
+        writeAt<int32_t>(record + 12, icon.fileVersion);
+        writeAt<int32_t>(record + 16, pixels.width());
+        writeAt<int32_t>(record + 20, pixels.height());
+        writeAt<uint64_t>(record + 24, imageOffsets[icon.image]);
+        std::memcpy(base + namesOffset, icon.name.data(), icon.name.size());
+        namesOffset += icon.name.size();
+    }
+    std::memcpy(base + HEADER_SIZE + icons.size() * ICON_SIZE, slots.data(), slots.size() * SLOT_SIZE);
+    for (size_t image = 0; image < images.size(); ++image) {
+        std::memcpy(base + imageOffsets[image], images[image].words(), images[image].sizeInBytes());
+    }
+    ::munmap(address, size);
+
+    // Switch over. Readers that already picked the previous number find
+    // its segment gone and look again.
+    mControl->generation.store(number, std::memory_order_release);
+    if (previous != 0) {
+        ::shm_unlink(segmentName(previous).c_str());
+    }
+
+    mStaged.clear();
+    return number;
+}
+
+size_t SharedIconStore::staged() const
+{
+    return mStaged.size();
+}
+
+bool SharedIconStore::unlink()
+{
+    const uint64_t number = published();
+    unmapControl();
+    if (number != 0) {
+        ::shm_unlink(segmentName(number).c_str());
+    }
+    return ::shm_unlink(mName.c_str()) == 0;
+}
+
+bool SharedIconStore::attach()
+{
+    for (int attempt = 0; attempt < ATTACH_ATTEMPTS; ++attempt) {
+        const uint64_t number = published();
+        if (number == 0) {
+            std::cerr << "No icons published as '" << mName << "'" << endl;
+            return false;
+        }
+        std::shared_ptr<const Generation> generation = Generation::open(segmentName(number), number);
+        if (generation) {
+            std::atomic_store(&mCurrent, generation);
+            return true;
+        }
+        if (published() == number) {
+            break;
+        }
+    }
+    std::cerr << "Unable to attach to '" << mName << "'" << endl;
+    return false;
+}
+
+bool SharedIconStore::refresh()
+{
+    std::shared_ptr<const Generation> generation = current();
+    const uint64_t number = published();
+    if (number == 0 || (generation && generation->number() == number)) {
+        return false;
+    }
+    return attach();
+}
+
+std::shared_ptr<const SharedIconStore::Generation> SharedIconStore::current() const
+{
+    return std::atomic_load(&mCurrent);
+}
+
+uint64_t SharedIconStore::published()
+{
+    if (!mControl && !mapControl(false)) {
+        return 0;
+    }
+    return mControl->generation.load(std::memory_order_acquire);
+}
+
+bool SharedIconStore::mapControl(bool writable)
+{
+    if (mControl && (mControlWritable || !writable)) {
+        return true;
+    }
+    unmapControl();
+
+    int fd = writable ? ::shm_open(mName.c_str(), O_RDWR | O_CREAT, 0644)
+                      : ::shm_open(mName.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        if (writable) {
+            std::cerr << "Unable to open shared memory '" << mName << "'" << endl;
+        }
+        return false;
+    }
+
+    // A new control segment is empty; ftruncate zero fills it, which is
+    // generation 0.
+    struct stat st;
+    bool ok = ::fstat(fd, &st) == 0;
+    if (ok && st.st_size == 0 && writable) {
+        ok = ::ftruncate(fd, off_t(sizeof(Control))) == 0;
+        st.st_size = off_t(sizeof(Control));
+    }
+    void *address = MAP_FAILED;
+    if (ok && size_t(st.st_size) >= sizeof(Control)) {
+        address = ::mmap(0, sizeof(Control), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "'" << mName << "' is not an icon store" << endl;
+        return false;
+    }
+
+    Control *control = static_cast<Control *>(address);
+    if (writable && control->generation.load(std::memory_order_acquire) == 0) {
+        std::memcpy(control->magic, CONTROL_MAGIC, sizeof(CONTROL_MAGIC));
+    }
+    if (std::memcmp(control->magic, CONTROL_MAGIC, sizeof(CONTROL_MAGIC)) != 0) {
+        std::cerr << "'" << mName << "' is not an icon store" << endl;
+        ::munmap(address, sizeof(Control));
+        return false;
+    }
+
+    mControl = control;
+    mControlWritable = writable;
+    return true;
+}
+
+void SharedIconStore::unmapControl()
+{
+    if (mControl) {
+        ::munmap(mControl, sizeof(Control));
+        mControl = 0;
+        mControlWritable = false;
+    }
+}
+
+string SharedIconStore::segmentName(uint64_t number) const
+{
+    return mName + "." + std::to_string(number);
+}
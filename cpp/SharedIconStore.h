@@ -0,0 +1,242 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SHAREDICONSTORE_H
+#define SHAREDICONSTORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+#include "StagedImages.h"
+
+class SimpleIcon;
+
+/**
+ * Decoded icons in POSIX shared memory, shared by all processes of a host.
+ *
+ * One loader process add()s icons and publish()es them; any number of
+ * processes attach() and get icons whose pixels are read-only views
+ * (Bitplane::view) into the shared segment, so nothing is copied or
+ * parsed again. Identical images are stored once, as in IconAtlas.
+ *
+ * Every publish() creates a new generation: a segment named
+ * "<name>.<generation>" is filled completely, then the generation number
+ * in the small control segment "<name>" is switched atomically and the
+ * previous generation's segment is unlinked. Attached processes keep
+ * their mapping of the old generation until they refresh() and the last
+ * icon taken from it is gone, so a reload never invalidates icons in use.
+ *
+ * A generation segment, all offsets from its start, native byte order as
+ * it never leaves the host:
+ *
+ *     offset size field
+ *          0    8 magic "SIMPLSHM"
+ *          8    8 generation number
+ *         16    8 segment size
+ *         24    4 icon count N
+ *         28    4 image count I
+ *         32    4 hash slot count S, a power of two larger than N
+ *         36   28 reserved
+ *         64 N*32 icons: name offset, name length, file version, width,
+ *                 height, pixel offset (see below)
+ *          .  S*4 open addressing hash of the names as in IconAtlas:
+ *                 icon index + 1, or 0 for a free slot
+ *          .    . names
+ *          .    . images in Bitplane layout, each 64 byte aligned
+ *
+ * Icon records are 8 byte fields for the offsets and 4 byte fields
+ * otherwise: name offset (8), name length (4), file version (4),
+ * width (4), height (4), pixel offset (8).
+ */
+class SharedIconStore
+{
+public:
+    /** Signature of a generation segment. */
+    static const char SEGMENT_MAGIC[8];
+
+    /**
+     * One published generation, mapped read-only. Icons taken from it
+     * share ownership of it, so the mapping lasts as long as they do.
+     */
+    class Generation : public std::enable_shared_from_this<Generation>
+    {
+    public:
+        Generation(const Generation &) = delete;
+        Generation & operator=(const Generation &) = delete;
+        ~Generation();
+
+        /**
+         * Look up an icon by name.
+         * @param name Name of the icon
+         * @param icon Receives the icon, viewing the shared pixels
+         * @return true if the generation holds the icon
+         */
+        bool find(string_view name, SimpleIcon &icon) const;
+
+        /**
+         * Read an icon by index, in the order the icons were added.
+         * @param index 0 <= index < size()
+         * @param icon Receives the icon, viewing the shared pixels
+         * @return true if the index is valid
+         */
+        bool icon(size_t index, SimpleIcon &icon) const;
+
+        /**
+         * Name of an icon, valid as long as the generation.
+         * @param index 0 <= index < size()
+         */
+        string_view name(size_t index) const;
+
+        /** Generation number, counting from 1. */
+        uint64_t number() const { return mNumber; }
+
+        /** Number of icons. */
+        size_t size() const { return mIconCount; }
+
+        /** Number of distinct images. */
+        size_t uniqueImages() const { return mImageCount; }
+
+        /** Size of the mapped segment in bytes. */
+        size_t sizeInBytes() const { return mSize; }
+
+    private:
+        friend class SharedIconStore;
+
+        Generation(const char *base, size_t size);
+
+        /**
+         * Map a generation segment and validate it completely, so that
+         * lookups need no checks.
+         * @return 0 if the segment does not exist or is damaged
+         */
+        static std::shared_ptr<const Generation> open(const string &segment,
+                                                      uint64_t number);
+
+        const char *mBase;
+        size_t mSize;
+        uint64_t mNumber;
+        uint32_t mIconCount;
+        uint32_t mImageCount;
+        uint32_t mSlotCount;
+        const char *mIcons;
+        const uint32_t *mSlots;
+    };
+
+    /**
+     * Construct a store without touching shared memory yet.
+     * @param name Name of the control segment, "/" followed by at most
+     * 200 characters other than "/"
+     */
+    explicit SharedIconStore(const string &name);
+
+    SharedIconStore(const SharedIconStore &) = delete;
+    SharedIconStore & operator=(const SharedIconStore &) = delete;
+    ~SharedIconStore();
+
+    // PUBLISHING
+
+    /**
+     * Stage an icon for the next publish().
+     * @param icon Icon to add
+     * @param name Name to file the icon under, the icon's own name if
+     * empty; must not have been added before
+     * @return true if the icon was added
+     */
+    bool add(const SimpleIcon &icon, string_view name = string_view());
+
+    /**
+     * Write all staged icons as a new generation and switch attached
+     * processes over on their next refresh(). The staged icons are
+     * dropped afterwards, so every generation is a complete library.
+     * Only one process may publish to a store at a time.
+     * @return Number of the new generation, 0 on failure
+     */
+    uint64_t publish();
+
+    /**
+     * Number of icons staged for the next publish().
+     */
+    size_t staged() const;
+
+    /**
+     * Remove the store's segments from the system. Processes that are
+     * attached keep their mappings.
+     * @return true if the store existed
+     */
+    bool unlink();
+
+    // ATTACHING
+
+    /**
+     * Attach the latest published generation.
+     * @return true if there is one
+     */
+    bool attach();
+
+    /**
+     * Attach the latest generation if it is newer than the current one.
+     * @return true if a newer generation has been attached
+     */
+    bool refresh();
+
+    /**
+     * The attached generation, 0 before attach(). Safe to call while
+     * another thread runs refresh().
+     */
+    std::shared_ptr<const Generation> current() const;
+
+    /**
+     * Number of the latest published generation, 0 if there is none.
+     */
+    uint64_t published();
+
+private:
+    struct Control;
+
+    string mName;
+    StagedImages mStaged;
+
+    Control *mControl;      ///< mapped control segment, 0 if not yet
+    bool mControlWritable;
+    std::shared_ptr<const Generation> mCurrent;
+
+    /**
+     * Map the control segment, creating it if writable.
+     */
+    bool mapControl(bool writable);
+    void unmapControl();
+
+    /**
+     * Name of the segment of a generation.
+     */
+    string segmentName(uint64_t number) const;
+};
+
+#endif
@@ -22,15 +22,24 @@
  */
 
 #include "SimpleIcon.h"
+#include "PixelDecoder.h"
+#include "PixelEncoder.h"
+#include "MappedFile.h"
+#include "BinaryFormat.h"
+#include "RunLengthCodec.h"
+#include "SparseBitplane.h"
+#include "SimpleIconStats.h"
+#include "IconArena.h"
+#include "LazyPixels.h"
 
-#include <fstream>
-using std::ifstream;
+#include <unistd.h>
 
-#include <vector>
-using std::vector;
+#include <algorithm>
+#include <cstring>
 
-#include <sstream>
-using std::stringstream;
+#include <charconv>
+
+#include <utility>
 
 #include <iostream>
 using std::cout;
@@ -38,163 +47,654 @@ using std::endl;
 
 const string SimpleIcon::DELIM = ";;";
 
+namespace {
+
+/**
+ * "ascii art" for every possible run of 8 pixels, so rendering needs one
+ * lookup per 8 pixels.
+ */
+struct RenderTable
+{
+    char chars[256][8];
+
+    constexpr RenderTable() :
+        chars()
+    {
+        for (int byte = 0; byte < 256; ++byte) {
+            for (int bit = 0; bit < 8; ++bit) {
+                chars[byte][bit] = ((byte >> bit) & 1) ? 'x' : ' ';
+            }
+        }
+    }
+};
+
+constexpr RenderTable RENDER_TABLE;
+
+/** Largest frame buffer a thread keeps between renderTo(FILE *) calls. */
+const size_t KEPT_FRAME_BYTES = size_t(1) << 20;
+
+bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+/**
+ * Parse a positive decimal number starting at pos, skipping blanks around
+ * it. Signs, overflow and zero are rejected.
+ * @return false if there is no valid number at pos
+ */
+bool parsePositive(string_view text, size_t &pos, int &value)
+{
+    while (pos < text.size() && isBlank(text[pos])) {
+        ++pos;
+    }
+    const char *begin = text.data() + pos;
+    const char *end = text.data() + text.size();
+    if (begin == end || *begin < '0' || *begin > '9') {
+        return false;
+    }
+
+    int parsed = 0;
+    std::from_chars_result result = std::from_chars(begin, end, parsed);
+    if (result.ec != std::errc() || parsed <= 0) {
+        return false;
+    }
+
+    pos = size_t(result.ptr - text.data());
+    while (pos < text.size() && isBlank(text[pos])) {
+        ++pos;
+    }
+    value = parsed;
+    return true;
+}
+
+/**
+ * Whether the content has all three header delimiters and no line break
+ * before the last of them.
+ */
+bool isUnwrappedHeader(string_view content)
+{
+    size_t end = 0;
+    for (int i = 0; i < 3; ++i) {
+        end = content.find(SimpleIcon::DELIM, end);
+        if (end == string_view::npos) {
+            return false;
+        }
+        end += SimpleIcon::DELIM.size();
+    }
+    return !std::memchr(content.data(), '\n', end);
+}
+
+/**
+ * Whether text continues with the field delimiter at pos.
+ */
+bool atDelim(string_view text, size_t pos)
+{
+    return text.compare(pos, SimpleIcon::DELIM.size(), SimpleIcon::DELIM) == 0;
+}
+
+}
+
 SimpleIcon::SimpleIcon() :
-    mName(), mFileVersion(1), mWidth(8), mHeight(8), mData(0)
+    mError(SimpleIcon::Error::NO_ERROR), mName(), mNameStorage(), mArena(0),
+    mFileVersion(1), mWidth(8), mHeight(8), mPixels(), mLazy()
 {
 }
 
+SimpleIcon::SimpleIcon(const string &name, int fileVersion, Bitplane pixels) :
+    mError(SimpleIcon::Error::NO_ERROR), mName(), mNameStorage(name),
+    mArena(0), mFileVersion(fileVersion), mWidth(pixels.width()),
+    mHeight(pixels.height()), mPixels(std::move(pixels)), mLazy()
+{
+    mName = mNameStorage;
+}
+
 SimpleIcon::SimpleIcon(const string &file) :
     SimpleIcon()
 {
     loadFromFile(file);
 }
 
-SimpleIcon::~SimpleIcon()
+SimpleIcon::SimpleIcon(IconArena &arena) :
+    SimpleIcon()
 {
-    if (mData) {
-        for (int i = 0; i < mHeight; ++i) {
-            if (mData[i]) {
-                delete mData[i];
-            }
+    mArena = &arena;
+    mPixels.setArena(&arena);
+}
+
+SimpleIcon::SimpleIcon(const SimpleIcon &other) :
+    mError(other.mError), mName(), mNameStorage(other.mName), mArena(0),
+    mFileVersion(other.mFileVersion), mWidth(other.mWidth),
+    mHeight(other.mHeight), mPixels(other.mPixels), mLazy(other.mLazy)
+{
+    mName = mNameStorage;
+}
+
+SimpleIcon::SimpleIcon(SimpleIcon &&other) noexcept :
+    SimpleIcon()
+{
+    *this = std::move(other);
+}
+
+SimpleIcon & SimpleIcon::operator=(const SimpleIcon &other)
+{
+    if (this != &other) {
+        *this = SimpleIcon(other);
+    }
+    return *this;
+}
+
+SimpleIcon & SimpleIcon::operator=(SimpleIcon &&other) noexcept
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    const bool owned = other.mArena == 0;
+    mError = other.mError;
+    mNameStorage = std::move(other.mNameStorage);
+    mName = owned ? string_view(mNameStorage) : other.mName;
+    mArena = other.mArena;
+    mFileVersion = other.mFileVersion;
+    mWidth = other.mWidth;
+    mHeight = other.mHeight;
+    mPixels = std::move(other.mPixels);
+    mLazy = std::move(other.mLazy);
+
+    other.mName = string_view();
+    other.mNameStorage.clear();
+    return *this;
+}
+
+bool SimpleIcon::loadFromFile(const string &file, LoadMode mode)
+{
+    std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>();
+    {
+        SIMPLEICON_STAGE(IO, 0);
+        mapped->open(file);
+        SIMPLEICON_STAGE_BYTES(mapped->size());
+    }
+    if (!mapped->isOpen()) {
+        std::cerr << "Unable to open file '" << file << "'" << endl;
+        mError = SimpleIcon::Error::FILE_NOT_READABLE;
+        return false;
+    }
+
+    // Parse file content
+    return load(mapped->view(), mode, mapped);
+}
+
+bool SimpleIcon::loadFromMemory(string_view content, LoadMode mode)
+{
+    return load(content, mode, nullptr);
+}
+
+bool SimpleIcon::load(string_view content, LoadMode mode, std::shared_ptr<const void> owner)
+{
+    mLazy.reset();
+    if (BinaryFormat::isBinary(content)) {
+        mError = parseBinary(content);
+        return mError == SimpleIcon::Error::NO_ERROR;
+    }
+
+    while (!content.empty() && (content.back() == '\n' || content.back() == '\r')) {
+        content.remove_suffix(1);
+    }
+
+    // A lazy load should not scan the whole payload for line breaks. After
+    // an unwrapped header, a payload of exactly width * height digits
+    // cannot contain any.
+    if (mode == LAZY && isUnwrappedHeader(content)) {
+        Header header;
+        mError = parseHeaderFields(content, header);
+        if (mError != SimpleIcon::Error::NO_ERROR) {
+            return false;
+        }
+        if (header.data.size() == size_t(header.width) * size_t(header.height)) {
+            mError = parseHeader(content, mode, owner);
+            return mError == SimpleIcon::Error::NO_ERROR;
+        }
+    }
+
+    // Only content wrapped over several lines needs to be joined first.
+    if (content.empty() || !std::memchr(content.data(), '\n', content.size())) {
+        mError = parseHeader(content, mode, owner);
+        return mError == SimpleIcon::Error::NO_ERROR;
+    }
+
+    std::shared_ptr<string> joined = std::make_shared<string>();
+    joined->reserve(content.size());
+    SIMPLEICON_ALLOCATION(content.size());
+    for (char c : content) {
+        if (c != '\n' && c != '\r') {
+            *joined += c;
         }
-        delete mData;
     }
+    mError = parseHeader(*joined, mode, joined);
+    return mError == SimpleIcon::Error::NO_ERROR;
+}
 
-    mData = 0;
+bool SimpleIcon::saveBinary(const string &file) const
+{
+    return BinaryFormat::writeAll(file, BinaryFormat::encode(mName, mFileVersion, pixels()));
 }
 
-bool SimpleIcon::loadFromFile(const string &file)
+bool SimpleIcon::saveToFile(const string &file, int fileVersion) const
 {
-    ifstream fs(file);
-    string fileContent;
-    string line;
+    string content;
+    return encode(fileVersion, content) && BinaryFormat::writeAll(file, content);
+}
 
-    while (getline(fs, line)) {
-        fileContent += line;
+bool SimpleIcon::encode(int fileVersion, string &out) const
+{
+    if (fileVersion < 1 || fileVersion > 4) {
+        std::cerr << "Unable to encode file version " << fileVersion << endl;
+        return false;
     }
 
-    // Parse file content
-    parseHeader(fileContent);
+    const Bitplane &image = pixels();
+    const size_t area = size_t(image.width()) * size_t(image.height());
+    SIMPLEICON_STAGE(ENCODE, area);
+    const string header = string(mName) + DELIM + std::to_string(fileVersion) + DELIM +
+                          std::to_string(mWidth) + "x" + std::to_string(mHeight) + DELIM;
+
+    // Versions 1 and 2 have a known size and are written in place; the
+    // compressed versions come out of their codecs as strings.
+    if (fileVersion <= 2) {
+        out.resize(header.size() + area);
+        std::memcpy(&out[0], header.data(), header.size());
+        if (area > 0) {
+            if (fileVersion == 1) {
+                PixelEncoder::encodeV1(image, &out[header.size()]);
+            } else {
+                PixelEncoder::encodeV2(image, &out[header.size()]);
+            }
+        }
+        return true;
+    }
+
+    const string payload = fileVersion == 3 ? RunLengthCodec::encode(image)
+                                            : SparseBitplane::fromBitplane(image).encode();
+    out.reserve(header.size() + payload.size());
+    out.assign(header);
+    out.append(payload);
     return true;
 }
 
-void SimpleIcon::display() const
+void SimpleIcon::display(int scale) const
+{
+    renderTo(stdout, scale);
+}
+
+bool SimpleIcon::renderTo(string &out, int scale) const
 {
-    cout << mName << "(" << mWidth << "x" << mHeight << ")" << endl <<
-            "Version: " << mFileVersion << endl;
+    const Bitplane &image = pixels();
+    // The limit for decoded images also keeps the frame size in range.
+    const uint64_t scaledWidth = uint64_t(image.width()) * uint64_t(std::max(scale, 0));
+    const uint64_t scaledHeight = uint64_t(image.height()) * uint64_t(std::max(scale, 0));
+    if (scale < 1 || (!image.empty() && !Bitplane::sizeAllowed(scaledWidth, scaledHeight))) {
+        std::cerr << "Illegal scale " << scale << " for a " << image.width() << "x" <<
+                     image.height() << " image" << endl;
+        out.clear();
+        return false;
+    }
+    const int width = image.width();
+    const size_t lineLength = size_t(width) * size_t(scale) + 1;
+    SIMPLEICON_STAGE(RENDER, lineLength * size_t(image.height()) * size_t(scale));
+    const string header = string(mName) + "(" + std::to_string(mWidth) + "x" +
+                          std::to_string(mHeight) + ")\nVersion: " +
+                          std::to_string(mFileVersion) + "\n";
+
+    out.resize(header.size() + lineLength * size_t(image.height()) * size_t(scale));
+    char *dst = &out[0];
+    std::memcpy(dst, header.data(), header.size());
+    dst += header.size();
+
+    for (int row = 0; row < image.height(); ++row) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(image.row(row));
+        if (scale == 1) {
+            int col = 0;
+            for (; col + 8 <= width; col += 8) {
+                std::memcpy(dst + col, RENDER_TABLE.chars[bytes[col >> 3]], 8);
+            }
+            if (col < width) {
+                std::memcpy(dst + col, RENDER_TABLE.chars[bytes[col >> 3]], width - col);
+            }
+        } else {
+            for (int col = 0; col < width; ++col) {
+                std::memset(dst + size_t(col) * size_t(scale),
+                            RENDER_TABLE.chars[bytes[col >> 3]][col & 7], size_t(scale));
+            }
+        }
+        dst[lineLength - 1] = '\n';
+        dst += lineLength;
 
-    for (int col = 0; col < mHeight; ++col) {
-        for (int row = 0; row < mWidth; ++row) {
-            cout << ((mData[col][row] == '1') ? 'x' : ' ');
+        // The other lines of an upscaled row are copies of the first.
+        for (int copy = 1; copy < scale; ++copy) {
+            std::memcpy(dst, dst - lineLength, lineLength);
+            dst += lineLength;
         }
-        cout << endl;
     }
+    return true;
 }
 
-int SimpleIcon::parseHeader(const string &fileContent)
+bool SimpleIcon::renderTo(FILE *out, int scale) const
 {
-    //istringstream stream(fileContent);
-    string text(fileContent);
-    vector<string> tokens;
-    size_t pos = std::string::npos;
-
-    while ((pos = text.find(DELIM)) != std::string::npos) {
-        tokens.push_back(text.substr(0, pos));
-        text.erase(0, pos + DELIM.length());
+    // Reused so repeated frames need no allocation, but one large frame
+    // must not stay pinned for the lifetime of the thread.
+    static thread_local string frame;
+    if (!renderTo(frame, scale)) {
+        return false;
     }
-    tokens.push_back(text);
 
-    // Check file format
-    if (tokens.size() != 4) {
-        std::cerr << "Input file has illegal format (expect 4 fields)" << endl;
-        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    SIMPLEICON_STAGE(OUTPUT, frame.size());
+    std::fflush(out);
+    const int fd = fileno(out);
+    const char *data = frame.data();
+    size_t remaining = frame.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written <= 0) {
+            break;
+        }
+        data += written;
+        remaining -= size_t(written);
     }
 
-    // Set data
-    stringstream version(tokens[1]);
-    mName = tokens[0];
-    string fileData = tokens[3];
-    if ((version >> mFileVersion).fail()) {
-        std::cerr << "File version number '" << tokens[1] << "' is not a number" << endl;
-        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    if (frame.capacity() > KEPT_FRAME_BYTES) {
+        string().swap(frame);
     }
+    return remaining == 0;
+}
 
-    string size(tokens[2]);
-    pos = size.find("x");
-    if (pos == std::string::npos) {
-        std::cerr << "Illegal image size value '" << size << "'" << endl;
-        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+Thumbnail SimpleIcon::thumbnail(int factor) const
+{
+    return mLazy ? mLazy->thumbnail(factor) : Thumbnail::fromBitplane(mPixels, factor);
+}
+
+bool SimpleIcon::combine(const SimpleIcon &other, BitplaneOps::Op op, int x, int y)
+{
+    return BitplaneOps::combine(mutablePixels(), other.pixels(), op, x, y);
+}
+
+bool SimpleIcon::invert()
+{
+    return BitplaneOps::invert(mutablePixels());
+}
+
+bool SimpleIcon::flipHorizontal()
+{
+    return BitplaneOps::flipHorizontal(mutablePixels());
+}
+
+bool SimpleIcon::flipVertical()
+{
+    return BitplaneOps::flipVertical(mutablePixels());
+}
+
+bool SimpleIcon::rotate90(bool clockwise)
+{
+    Bitplane rotated = BitplaneOps::rotate90(pixels(), clockwise);
+    if (rotated.empty() && !pixels().empty()) {
+        return false;
     }
+    setPixels(std::move(rotated));
+    return true;
+}
 
-    stringstream* str = new stringstream(size.substr(0, pos));
-    if ((*str >> mWidth).fail()) {
-        std::cerr << "Fail to convert width value '" << str->str() << "'" << endl;
-        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+SimpleIcon SimpleIcon::cropped(int x, int y, int width, int height) const
+{
+    return SimpleIcon(string(mName), mFileVersion,
+                      BitplaneOps::crop(pixels(), x, y, width, height));
+}
+
+uint64_t SimpleIcon::pixelCount() const
+{
+    return BitplaneAnalysis::countPixels(pixels());
+}
+
+void SimpleIcon::rowPixelCounts(std::vector<int> &counts) const
+{
+    BitplaneAnalysis::countRows(pixels(), counts);
+}
+
+BitplaneAnalysis::Rect SimpleIcon::boundingBox() const
+{
+    return BitplaneAnalysis::boundingBox(pixels());
+}
+
+int SimpleIcon::components(std::vector<BitplaneAnalysis::Component> &components,
+                           BitplaneAnalysis::Connectivity connectivity) const
+{
+    return BitplaneAnalysis::labelComponents(pixels(), components, connectivity);
+}
+
+int SimpleIcon::parseHeader(string_view fileContent, LoadMode mode,
+                            const std::shared_ptr<const void> &owner)
+{
+    Header header;
+    int error;
+    {
+        SIMPLEICON_STAGE(HEADER, 0);
+        error = parseHeaderFields(fileContent, header);
+        SIMPLEICON_STAGE_BYTES(fileContent.size() - header.data.size());
     }
-    str = new stringstream(size.substr(++pos));
-    if ((*str >> mHeight).fail()) {
-        std::cerr << "Fail to convert height value '" << str->str() << "'" << endl;
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        return error;
+    }
+    if (header.fileVersion > 4) {
+        std::cerr << "Unsupported file version " << header.fileVersion << endl;
         return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
     }
 
+    // Set data
+    setName(header.name);
+    mFileVersion = header.fileVersion;
+    mWidth = header.width;
+    mHeight = header.height;
+    string_view fileData = header.data;
+
+    if (mode == LAZY && (mFileVersion == 1 || mFileVersion == 2)) {
+        mPixels.clear();
+        mLazy = std::make_shared<const LazyPixels>(owner, fileData, mFileVersion,
+                                                   mWidth, mHeight);
+        return SimpleIcon::Error::NO_ERROR;
+    }
+
     // parse data
+    SIMPLEICON_STAGE(DECODE, fileData.size());
     switch (mFileVersion) {
     case 1:
-        parseData(fileData);
+        error = parseData(fileData);
         break;
     case 2:
-        parseDataV2(fileData);
+        error = parseDataV2(fileData);
+        break;
+    case 3:
+        error = parseDataV3(fileData);
         break;
     default:
-        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+        error = parseDataV4(fileData);
+        break;
     }
-
-    return SimpleIcon::Error::NO_ERROR;
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        keepSizeOfPixels();
+    }
+    return error;
 }
 
-void SimpleIcon::parseData(const string &fileData)
+void SimpleIcon::keepSizeOfPixels()
 {
-    int offset = 0;
-    char **data;
-    data = new char * [mHeight];
-    for (int i = 0; i < mHeight; ++i)
-        data[i] = new char[mWidth];
+    mWidth = mPixels.width();
+    mHeight = mPixels.height();
+}
 
+void SimpleIcon::setName(string_view name)
+{
+    if (mArena) {
+        mName = mArena->copy(name);
+    } else {
+        mNameStorage.assign(name.data(), name.size());
+        mName = mNameStorage;
+    }
+}
 
-    for (int col = 0; col < mHeight; ++col) {
-        for (int row = 0; row < mWidth; ++row) {
-            data[col][row] = fileData[offset++];
+Bitplane & SimpleIcon::mutablePixels()
+{
+    if (mLazy) {
+        mPixels = mLazy->materialize();
+        mLazy.reset();
+        if (mPixels.empty()) {
+            // Keep width() and height() in line with the missing pixels.
+            mError = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+            mWidth = mHeight = 0;
         }
     }
+    return mPixels;
+}
 
-    mData = data;
+void SimpleIcon::setPixels(Bitplane pixels)
+{
+    mLazy.reset();
+    mWidth = pixels.width();
+    mHeight = pixels.height();
+    mPixels = std::move(pixels);
 }
 
-void SimpleIcon::parseDataV2(const string &fileData)
+int SimpleIcon::parseDataV3(string_view fileData)
 {
-    int charPos = 0;
-    int offset = 0;
-    char **data;
-    data = new char * [mHeight];
-    for (int i = 0; i < mHeight; ++i)
-        data[i] = new char[mWidth];
+    if (!mPixels.reset(mWidth, mHeight)) {
+        std::cerr << "Illegal image size" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    return RunLengthCodec::decode(fileData, mPixels);
+}
 
-    for (offset = 0; offset < mWidth; offset += 8) {
-        for (int col = 0; col < mHeight; ++col) {
-            for (int row = offset; row < offset + 8; ++row) {
-                if (row >= mWidth)
-                    continue;
-                data[col][row] = fileData[charPos++];
-            }
+int SimpleIcon::parseDataV4(string_view fileData)
+{
+    if (mWidth <= 0 || mHeight <= 0) {
+        std::cerr << "Illegal image size" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+
+    SparseBitplane tiles;
+    int error = SparseBitplane::decode(fileData, mWidth, mHeight, tiles);
+    if (error == SimpleIcon::Error::NO_ERROR) {
+        Bitplane decoded = tiles.toBitplane();
+        if (mPixels.arena()) {
+            // Copy so the pixels end up in the arena as well.
+            mPixels = decoded;
+        } else {
+            mPixels = std::move(decoded);
         }
     }
+    return error;
+}
+
+int SimpleIcon::parseBinary(string_view fileContent)
+{
+    BinaryFormat::Header header;
+    int error = BinaryFormat::readHeader(fileContent, header);
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        return error;
+    }
+
+    setName(BinaryFormat::name(fileContent, header));
+    mFileVersion = int(header.fileVersion);
+    mWidth = int(header.width);
+    mHeight = int(header.height);
+    SIMPLEICON_STAGE(DECODE, fileContent.size());
+    error = BinaryFormat::readPixels(fileContent, header, mPixels);
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        keepSizeOfPixels();
+    }
+    return error;
+}
+
+int SimpleIcon::parseData(string_view fileData)
+{
+    if (!mPixels.reset(mWidth, mHeight)) {
+        std::cerr << "Illegal image size" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    PixelDecoder::decodeV1(fileData.data(), fileData.size(), mPixels);
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+int SimpleIcon::parseDataV2(string_view fileData)
+{
+    if (!mPixels.reset(mWidth, mHeight)) {
+        std::cerr << "Illegal image size" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    PixelDecoder::decodeV2(fileData.data(), fileData.size(), mPixels);
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+int SimpleIcon::parseHeaderFields(string_view content, Header &header)
+{
+    size_t pos = content.find(DELIM);
+    if (pos == string_view::npos) {
+        std::cerr << "Input file has illegal format (expect 4 fields)" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    header.name = content.substr(0, pos);
+    pos += DELIM.size();
+
+    if (!parsePositive(content, pos, header.fileVersion) || !atDelim(content, pos)) {
+        std::cerr << "Illegal file version in header" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    pos += DELIM.size();
+
+    if (!parsePositive(content, pos, header.width) || pos >= content.size() ||
+        content[pos] != 'x' || !parsePositive(content, ++pos, header.height) ||
+        !atDelim(content, pos)) {
+        std::cerr << "Illegal image size in header" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    if (!Bitplane::sizeAllowed(uint64_t(header.width), uint64_t(header.height))) {
+        std::cerr << "Image size " << header.width << "x" << header.height <<
+                     " exceeds the limit" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    header.data = content.substr(pos + DELIM.size());
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+int SimpleIcon::parseVersion(string_view text, int &version)
+{
+    size_t pos = 0;
+    if (!parsePositive(text, pos, version) || pos != text.size()) {
+        std::cerr << "File version number '" << text << "' is not a number" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    return SimpleIcon::Error::NO_ERROR;
+}
 
-    mData = data;
+int SimpleIcon::parseSize(string_view text, int &width, int &height)
+{
+    size_t pos = 0;
+    if (!parsePositive(text, pos, width) || pos >= text.size() || text[pos] != 'x' ||
+        !parsePositive(text, ++pos, height) || pos != text.size()) {
+        std::cerr << "Illegal image size value '" << text << "'" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    if (!Bitplane::sizeAllowed(uint64_t(width), uint64_t(height))) {
+        std::cerr << "Image size " << width << "x" << height << " exceeds the limit" << endl;
+        return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    }
+    return SimpleIcon::Error::NO_ERROR;
 }
 
 // GETTER / SETTER
 
-const string & SimpleIcon::name() const
+int SimpleIcon::error() const
+{
+    return mError;
+}
+
+string_view SimpleIcon::name() const
 {
     return mName;
 }
@@ -214,7 +714,26 @@ int SimpleIcon::height() const
     return mHeight;
 }
 
-char ** SimpleIcon::data() const
+bool SimpleIcon::pixel(int x, int y) const
+{
+    return mLazy ? mLazy->pixel(x, y) : mPixels.get(x, y);
+}
+
+void SimpleIcon::readRow(int y, uint64_t *out) const
+{
+    if (mLazy) {
+        mLazy->readRow(y, out);
+    } else {
+        std::memcpy(out, mPixels.row(y), size_t(mPixels.stride()) * sizeof(uint64_t));
+    }
+}
+
+const Bitplane & SimpleIcon::pixels() const
+{
+    return mLazy ? mLazy->materialize() : mPixels;
+}
+
+bool SimpleIcon::isLazy() const
 {
-    return mData;
+    return mLazy != nullptr;
 }
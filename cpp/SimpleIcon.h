@@ -24,11 +24,29 @@
 #ifndef SIMPLEICON_H
 #define SIMPLEICON_H
 
+#include <cstdio>
+#include <memory>
+
 #include <string>
 using std::string;
 
+#include <string_view>
+using std::string_view;
+
+#include "Bitplane.h"
+#include "BitplaneAnalysis.h"
+#include "BitplaneOps.h"
+#include "Thumbnail.h"
+
+class IconArena;
+class LazyPixels;
+
 /**
  * Class representing a SimpleIcon instance.
+ *
+ * SimpleIcon is a value type. Moves only steal the buffers; copies share
+ * the decoded pixels copy-on-write (see Bitplane), so caches and
+ * containers can hold many copies of a large icon cheaply.
  */
 class SimpleIcon
 {
@@ -38,74 +56,386 @@ public:
      */
     enum Error {
         NO_ERROR = 0,
-        ILLEGAL_INPUT_FORMAT = 1
+        ILLEGAL_INPUT_FORMAT = 1,
+        FILE_NOT_READABLE = 2
     };
 
+    /**
+     * When to decode the pixels of version 1 and 2 files.
+     */
+    enum LoadMode {
+        EAGER = 0,  ///< decode everything while loading
+        LAZY = 1    ///< decode rows on first access (see LazyPixels)
+    };
+
+    /** Field delimiter in image datafiles. */
+    static const string DELIM;
+
     /**
      * Construct an empty SimpleIcon object.
      */
 	SimpleIcon();
 
+    /**
+     * Construct a SimpleIcon object from already decoded pixels.
+     * @param name Name of the image
+     * @param fileVersion File version the image was read from
+     * @param pixels Image data, its size becomes the image size
+     */
+    SimpleIcon(const string &name, int fileVersion, Bitplane pixels);
+
     /**
      * Construct a SimpleIcon object loading data from a specified file.
      * @param file File path to load data from
      */
     explicit SimpleIcon(const string &file);
 
-    ~SimpleIcon();
+    /**
+     * Construct an empty SimpleIcon object that keeps the name and pixels
+     * of later loads in an arena. The arena must outlive the object.
+     * Copies of the object do not use the arena.
+     * @param arena Arena to allocate from
+     */
+    explicit SimpleIcon(IconArena &arena);
+
+    SimpleIcon(const SimpleIcon &other);
+    SimpleIcon(SimpleIcon &&other) noexcept;
+    SimpleIcon & operator=(const SimpleIcon &other);
+    SimpleIcon & operator=(SimpleIcon &&other) noexcept;
 
     /**
      * Loads content from specified file and parses it.
+     * In LAZY mode only the header is parsed up front; the file stays
+     * mapped until the pixels are fully decoded or the icon is gone.
+     * Versions 3 and 4 and binary files are always decoded eagerly.
      * @param file Path to load data from
+     * @param mode When to decode the pixels
      * @return true if file reading and parsing succeeded
      */
-    bool loadFromFile(const string &file);
+    bool loadFromFile(const string &file, LoadMode mode = EAGER);
+
+    /**
+     * Parses image data held in memory, e.g. a mapped file.
+     * Text content has its line breaks ignored like when reading from a
+     * file; content starting with the BinaryFormat signature is read as a
+     * binary icon.
+     * @param content Complete file content; in LAZY mode it must stay
+     * valid until the pixels are fully decoded or the icon is gone
+     * @param mode When to decode the pixels
+     * @return true if parsing succeeded
+     */
+    bool loadFromMemory(string_view content, LoadMode mode = EAGER);
+
+    /**
+     * Write the image in the compact binary format (see BinaryFormat).
+     * @param file Path to write to, an existing file is replaced
+     * @return true if the file was written completely
+     */
+    bool saveBinary(const string &file) const;
+
+    /**
+     * Write the image as a text datafile.
+     * Header and payload are encoded into one buffer and written with a
+     * single write call.
+     * @param file Path to write to, an existing file is replaced
+     * @param fileVersion Payload encoding, 1 to 4
+     * @return true if the version is known and the file was written
+     * completely
+     */
+    bool saveToFile(const string &file, int fileVersion) const;
+
+    /**
+     * Encode the image as the content of a text datafile, the inverse of
+     * loadFromMemory().
+     * @param fileVersion Payload encoding, 1 to 4
+     * @param out Receives the content, replacing what it held
+     * @return true if the version is known
+     */
+    bool encode(int fileVersion, string &out) const;
 
     /**
      * Display the parsed image as "ascii art".
+     * The whole frame goes to standard output with a single write.
+     * @param scale Characters per pixel in each direction, for large
+     * terminals
+     */
+    void display(int scale = 1) const;
+
+    /**
+     * Render the image as "ascii art" into a buffer, replacing its content.
+     * The buffer's capacity is kept, so reusing it across frames avoids
+     * further allocations.
+     * @param out Receives the rendered frame
+     * @param scale Characters per pixel in each direction (nearest
+     * neighbour upscaling), at least 1; the upscaled size must pass
+     * Bitplane::sizeAllowed()
+     * @return false if the scale is out of range, out is left empty then
      */
-    void display() const;
+    bool renderTo(string &out, int scale = 1) const;
+
+    /**
+     * Render the image as "ascii art" and write it with a single write
+     * call. Pending stdio output of the stream is flushed first.
+     * @param out Stream to write to
+     * @param scale Characters per pixel in each direction, as for
+     * renderTo(string &, int)
+     * @return true if the frame was written completely
+     */
+    bool renderTo(FILE *out, int scale = 1) const;
+
+    /**
+     * Downscale the image by box filtering (see Thumbnail). Lazily loaded
+     * icons are not fully decoded for this.
+     * @param factor Image pixels per thumbnail pixel in each direction
+     */
+    Thumbnail thumbnail(int factor) const;
+
+    // IMAGE OPERATIONS (see BitplaneOps)
+
+    /**
+     * Merge another image into this one, in place. Pixels outside this
+     * image are clipped.
+     * @param other Image to merge in
+     * @param op Merge operation
+     * @param x Column of the other image's left edge, may be negative
+     * @param y Row of the other image's top edge, may be negative
+     * @return false if the pixels, shared with copies of this icon,
+     * could not be copied for the change; nothing changed then
+     */
+    bool combine(const SimpleIcon &other, BitplaneOps::Op op, int x = 0, int y = 0);
+
+    /**
+     * Invert all pixels in place.
+     * @return false if the pixels could not be unshared, as for combine()
+     */
+    bool invert();
+
+    /**
+     * Mirror the image left to right, in place.
+     * @return false if the pixels could not be unshared, as for combine()
+     */
+    bool flipHorizontal();
+
+    /**
+     * Mirror the image top to bottom, in place.
+     * @return false if the pixels could not be unshared, as for combine()
+     */
+    bool flipVertical();
+
+    /**
+     * Rotate the image by 90 degrees, swapping width and height.
+     * @param clockwise Direction of the rotation
+     * @return false if the rotated pixels could not be allocated; nothing
+     * changed then
+     */
+    bool rotate90(bool clockwise = true);
+
+    /**
+     * Copy a rectangle out of the image. The rectangle is clipped to the
+     * image; the copy keeps name and file version.
+     * @return The cropped image, empty if nothing is left after clipping
+     */
+    SimpleIcon cropped(int x, int y, int width, int height) const;
+
+    // ANALYSIS (see BitplaneAnalysis)
+
+    /**
+     * Number of set pixels.
+     */
+    uint64_t pixelCount() const;
+
+    /**
+     * Number of set pixels in each row.
+     * @param counts Receives height() counts
+     */
+    void rowPixelCounts(std::vector<int> &counts) const;
+
+    /**
+     * Smallest rectangle containing all set pixels, empty if there are
+     * none.
+     */
+    BitplaneAnalysis::Rect boundingBox() const;
+
+    /**
+     * Find the blobs of touching set pixels.
+     * @param components Receives the blobs in scan order
+     * @param connectivity Whether diagonal neighbours touch
+     * @return Number of blobs
+     */
+    int components(std::vector<BitplaneAnalysis::Component> &components,
+                   BitplaneAnalysis::Connectivity connectivity = BitplaneAnalysis::EIGHT) const;
 
     // GETTER / SETTER
-    const string & name() const;
+
+    /**
+     * Result of the last load, some value from SimpleIcon::Error.
+     */
+    int error() const;
+
+    string_view name() const;
     int fileVersion() const;
     int width() const;
     int height() const;
-    char ** data() const;
+
+    /**
+     * Read a single pixel of the parsed image.
+     * @param x Column of the pixel, 0 <= x < width()
+     * @param y Row of the pixel, 0 <= y < height()
+     * @return true if the pixel is set
+     */
+    bool pixel(int x, int y) const;
+
+    /**
+     * Copy one row of the image in Bitplane layout. Decodes only that
+     * row for lazily loaded icons.
+     * @param y Row to read, 0 <= y < height()
+     * @param out Receives Bitplane::strideFor(width()) words
+     */
+    void readRow(int y, uint64_t *out) const;
+
+    /**
+     * Packed pixel storage, one bit per pixel with word aligned rows.
+     * Decodes all pixels of a lazily loaded icon.
+     */
+    const Bitplane & pixels() const;
+
+    /**
+     * Whether the pixels were loaded in LAZY mode.
+     */
+    bool isLazy() const;
+
+    /**
+     * Fields of a text image datafile, as views into its content.
+     */
+    struct Header
+    {
+        string_view name;
+        int fileVersion;
+        int width;
+        int height;
+        string_view data;
+    };
+
+    /**
+     * Validate and extract all header fields in a single pass over the
+     * content, without allocating. Version, width and height must be
+     * positive decimal numbers that fit in an int; blanks around them are
+     * ignored. The size must pass Bitplane::sizeAllowed().
+     * @param content Complete file content without line breaks
+     * @param header Receives the fields
+     * @return Some value from SimpleIcon::Error
+     */
+    static int parseHeaderFields(string_view content, Header &header);
+
+    /**
+     * Parse the version field of an image datafile.
+     * @param text Content of the version field
+     * @param version Receives the version number
+     * @return Some value from SimpleIcon::Error
+     */
+    static int parseVersion(string_view text, int &version);
+
+    /**
+     * Parse the size field ("WxH") of an image datafile.
+     * @param text Content of the size field
+     * @param width Receives the width
+     * @param height Receives the height
+     * @return Some value from SimpleIcon::Error
+     */
+    static int parseSize(string_view text, int &width, int &height);
 	
 private:
-    /** Field delimiter in image datafiles. */
-    static const string DELIM;
-
-    string mName;
+    int mError;
+    string_view mName;  ///< into mNameStorage or mArena
+    string mNameStorage;
+    IconArena *mArena;
 	int mFileVersion;
 	int mWidth;
 	int mHeight;
-    char **mData;
+    Bitplane mPixels;
+    std::shared_ptr<const LazyPixels> mLazy;
+
+    /**
+     * Shared part of loadFromFile and loadFromMemory.
+     * @param owner Keeps the content alive for LAZY mode, may be empty
+     */
+    bool load(string_view content, LoadMode mode, std::shared_ptr<const void> owner);
+
+    /**
+     * Store the name in the arena if there is one, otherwise in
+     * mNameStorage.
+     */
+    void setName(string_view name);
+
+    /**
+     * Pixels for in place changes. Lazily loaded pixels are decoded and
+     * taken over first; storage shared with copies is detached by Bitplane.
+     */
+    Bitplane & mutablePixels();
+
+    /**
+     * Replace the pixels, taking over their size.
+     */
+    void setPixels(Bitplane pixels);
+
+    /**
+     * Make width() and height() match the pixels again after a failed
+     * decode, which may have left the previous pixels or none at all.
+     */
+    void keepSizeOfPixels();
 
     /**
      * Parse file header data and prepare to parse content.
-     * Splits file content on DELIM to obtain fields. Sets header information,
-     * then passes image data string either to parseData or parseDataV2.
-     * @param fileContent Complete file content as loaded from the file
+     * Reads the header with parseHeaderFields, sets header information,
+     * then passes the remaining image data to the decoder of its version.
+     * @param fileContent Complete file content without line breaks
+     * @param mode When to decode the pixels
+     * @param owner Keeps the content alive for LAZY mode, may be empty
      * @return Some value from SimpleIcon::Error. On Success, returns
      * NO_ERROR.
      */
-    int parseHeader(const string &fileContent);
+    int parseHeader(string_view fileContent, LoadMode mode = EAGER,
+                    const std::shared_ptr<const void> &owner = nullptr);
+
+    /**
+     * Read a binary icon (see BinaryFormat) with one bulk pixel copy.
+     * @param fileContent Complete file content
+     * @return Some value from SimpleIcon::Error
+     */
+    int parseBinary(string_view fileContent);
 
     /**
      * Parses the image data string into usable form.
      * Uses file version 1.
      * @param fileData Content of the data field from the file contents
+     * @return Some value from SimpleIcon::Error
      */
-    void parseData(const string &fileData);
+    int parseData(string_view fileData);
 
     /**
      * Parses the image data string into usable form.
      * Uses file version 2.
      * @param fileData Content of the data field from the file contents
+     * @return Some value from SimpleIcon::Error
+     */
+    int parseDataV2(string_view fileData);
+
+    /**
+     * Parses the image data string into usable form.
+     * Uses file version 3 (run length encoded rows, see RunLengthCodec).
+     * @param fileData Content of the data field from the file contents
+     * @return Some value from SimpleIcon::Error
+     */
+    int parseDataV3(string_view fileData);
+
+    /**
+     * Parses the image data string into usable form.
+     * Uses file version 4 (sparse 8x8 tiles, see SparseBitplane). The
+     * tiles are expanded into mPixels.
+     * @param fileData Content of the data field from the file contents
+     * @return Some value from SimpleIcon::Error
      */
-    void parseDataV2(const string &fileData);
+    int parseDataV4(string_view fileData);
 };
 
 #endif
@@ -0,0 +1,106 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SimpleIconBatch.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+SimpleIconBatch::SimpleIconBatch() :
+    mFiles()
+{
+}
+
+void SimpleIconBatch::addFile(const string &file)
+{
+    mFiles.push_back(file);
+}
+
+bool SimpleIconBatch::addDirectory(const string &directory)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code error;
+    fs::recursive_directory_iterator it(directory, error);
+    if (error) {
+        return false;
+    }
+
+    std::vector<string> found;
+    for (fs::recursive_directory_iterator end; it != end; it.increment(error)) {
+        if (error) {
+            return false;
+        }
+        if (it->is_regular_file(error)) {
+            found.push_back(it->path().string());
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    mFiles.insert(mFiles.end(), found.begin(), found.end());
+    return true;
+}
+
+std::vector<SimpleIconBatch::Result> SimpleIconBatch::load(ThreadPool &pool) const
+{
+    return load(0, pool);
+}
+
+std::vector<SimpleIconBatch::Result> SimpleIconBatch::load(IconArena &arena,
+                                                           ThreadPool &pool) const
+{
+    return load(&arena, pool);
+}
+
+std::vector<SimpleIconBatch::Result> SimpleIconBatch::load(IconArena *arena,
+                                                           ThreadPool &pool) const
+{
+    std::vector<Result> results(mFiles.size());
+
+    pool.parallelFor(mFiles.size(), [this, arena, &results](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Result &result = results[i];
+            result.file = mFiles[i];
+            if (arena) {
+                result.icon = SimpleIcon(*arena);
+            }
+            result.icon.loadFromFile(mFiles[i]);
+            result.error = result.icon.error();
+        }
+    });
+
+    return results;
+}
+
+// GETTER
+
+const std::vector<string> & SimpleIconBatch::files() const
+{
+    return mFiles;
+}
+
+size_t SimpleIconBatch::size() const
+{
+    return mFiles.size();
+}
@@ -0,0 +1,102 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIMPLEICONBATCH_H
+#define SIMPLEICONBATCH_H
+
+#include <string>
+#include <vector>
+using std::string;
+
+#include "IconArena.h"
+#include "SimpleIcon.h"
+#include "ThreadPool.h"
+
+/**
+ * Loads many image datafiles in parallel.
+ *
+ * Files are collected with addFile() / addDirectory() and decoded on a
+ * ThreadPool. Results come back in the order the files were added, each
+ * with its own SimpleIcon::Error code, so one broken file does not affect
+ * the others.
+ */
+class SimpleIconBatch
+{
+public:
+    /**
+     * Outcome of loading a single file.
+     */
+    struct Result
+    {
+        string file;
+        int error;
+        SimpleIcon icon;
+    };
+
+    /**
+     * Construct an empty batch.
+     */
+    SimpleIconBatch();
+
+    /**
+     * Append a single file to the batch.
+     * @param file Path of the image datafile
+     */
+    void addFile(const string &file);
+
+    /**
+     * Append all regular files below a directory, recursively and sorted
+     * by path so the order is stable.
+     * @param directory Directory to scan
+     * @return false if the directory could not be read
+     */
+    bool addDirectory(const string &directory);
+
+    /**
+     * Load all files of the batch.
+     * @param pool Pool to decode on
+     * @return One result per file, in input order
+     */
+    std::vector<Result> load(ThreadPool &pool = ThreadPool::shared()) const;
+
+    /**
+     * Load all files of the batch, keeping names and pixels of all icons
+     * in one arena instead of separate heap allocations.
+     * @param arena Arena to allocate from, must outlive the results
+     * @param pool Pool to decode on
+     * @return One result per file, in input order
+     */
+    std::vector<Result> load(IconArena &arena,
+                             ThreadPool &pool = ThreadPool::shared()) const;
+
+    // GETTER
+    const std::vector<string> & files() const;
+    size_t size() const;
+
+private:
+    std::vector<string> mFiles;
+
+    std::vector<Result> load(IconArena *arena, ThreadPool &pool) const;
+};
+
+#endif
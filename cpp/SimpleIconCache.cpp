@@ -0,0 +1,173 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SimpleIconCache.h"
+
+#include <sys/stat.h>
+
+#include <iterator>
+#include <utility>
+
+SimpleIconCache::SimpleIconCache(size_t budget, Loader loader) :
+    mMutex(), mBudget(budget), mLoader(std::move(loader)), mLru(), mIndex(), mLoading(),
+    mStats()
+{
+    if (!mLoader) {
+        mLoader = [](const string &file) { return std::make_shared<const SimpleIcon>(file); };
+    }
+}
+
+SimpleIconCache::Handle SimpleIconCache::get(const string &file)
+{
+    Stamp stamp;
+    const bool cacheable = stampOf(file, stamp);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    auto found = mIndex.find(file);
+    if (found != mIndex.end()) {
+        if (cacheable && found->second->stamp == stamp) {
+            mLru.splice(mLru.begin(), mLru, found->second);
+            ++mStats.hits;
+            return found->second->icon;
+        }
+        erase(found->second);
+    }
+
+    auto loading = mLoading.find(file);
+    if (loading != mLoading.end()) {
+        std::shared_future<Handle> pending = loading->second;
+        ++mStats.coalesced;
+        lock.unlock();
+        return pending.get();
+    }
+
+    std::promise<Handle> promise;
+    mLoading.emplace(file, promise.get_future().share());
+    ++mStats.misses;
+    lock.unlock();
+
+    // Waiting callers must not be left with a broken promise, and the
+    // next get() has to try again.
+    Handle icon;
+    try {
+        icon = mLoader(file);
+    } catch (...) {
+        lock.lock();
+        mLoading.erase(file);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    mLoading.erase(file);
+    const size_t bytes = costOf(*icon);
+    if (cacheable && icon->error() == SimpleIcon::Error::NO_ERROR && bytes <= mBudget) {
+        mLru.push_front(Entry{ file, stamp, icon, bytes });
+        mIndex[file] = mLru.begin();
+        mStats.bytes += bytes;
+        ++mStats.entries;
+        evict();
+    }
+    lock.unlock();
+
+    promise.set_value(icon);
+    return icon;
+}
+
+void SimpleIconCache::invalidate(const string &file)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mIndex.find(file);
+    if (found != mIndex.end()) {
+        erase(found->second);
+    }
+}
+
+void SimpleIconCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLru.clear();
+    mIndex.clear();
+    mStats.entries = 0;
+    mStats.bytes = 0;
+}
+
+void SimpleIconCache::setBudget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBudget = budget;
+    evict();
+}
+
+size_t SimpleIconCache::budget() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBudget;
+}
+
+SimpleIconCache::Stats SimpleIconCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void SimpleIconCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.hits = mStats.misses = mStats.coalesced = mStats.evictions = 0;
+}
+
+size_t SimpleIconCache::costOf(const SimpleIcon &icon)
+{
+    return sizeof(SimpleIcon) + icon.name().size() + icon.pixels().sizeInBytes();
+}
+
+bool SimpleIconCache::stampOf(const string &file, Stamp &stamp)
+{
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    stamp.seconds = int64_t(st.st_mtim.tv_sec);
+    stamp.nanoseconds = long(st.st_mtim.tv_nsec);
+    stamp.size = int64_t(st.st_size);
+    return true;
+}
+
+void SimpleIconCache::erase(Lru::iterator entry)
+{
+    mStats.bytes -= entry->bytes;
+    --mStats.entries;
+    mIndex.erase(entry->file);
+    mLru.erase(entry);
+}
+
+void SimpleIconCache::evict()
+{
+    while (mStats.bytes > mBudget && !mLru.empty()) {
+        erase(std::prev(mLru.end()));
+        ++mStats.evictions;
+    }
+}
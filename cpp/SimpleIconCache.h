@@ -0,0 +1,169 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIMPLEICONCACHE_H
+#define SIMPLEICONCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+using std::string;
+
+#include "SimpleIcon.h"
+
+/**
+ * Thread-safe cache of decoded icons, keyed by file path.
+ *
+ * An entry is valid as long as the file's modification time and size
+ * match those seen when it was loaded, so edited files are decoded again.
+ * Entries are evicted least recently used first once their total size
+ * exceeds the byte budget. Handles stay valid after eviction, the icon is
+ * freed when its last handle goes away. Concurrent get() calls for the
+ * same file that is not cached yet wait for a single decode.
+ */
+class SimpleIconCache
+{
+public:
+    /**
+     * Shared, immutable decoded icon.
+     */
+    typedef std::shared_ptr<const SimpleIcon> Handle;
+
+    /**
+     * Decodes a file on a miss, never returning an empty handle. It may
+     * throw; the exception is passed on
+     * to every get() waiting for that file and nothing is cached.
+     */
+    typedef std::function<Handle(const string &file)> Loader;
+
+    /** Default byte budget. */
+    static const size_t DEFAULT_BUDGET = size_t(64) << 20;
+
+    /**
+     * Counters since construction or the last resetStats().
+     */
+    struct Stats
+    {
+        uint64_t hits;        ///< served from the cache
+        uint64_t misses;      ///< decoded from the file
+        uint64_t coalesced;   ///< waited for a decode started by another call
+        uint64_t evictions;   ///< entries dropped to stay within the budget
+        size_t entries;       ///< entries currently cached
+        size_t bytes;         ///< size of the cached entries
+    };
+
+    /**
+     * Construct an empty cache.
+     * @param budget Upper limit for the size of all entries in bytes
+     * @param loader Decodes files, the SimpleIcon file constructor if
+     * empty
+     */
+    explicit SimpleIconCache(size_t budget = DEFAULT_BUDGET, Loader loader = Loader());
+
+    SimpleIconCache(const SimpleIconCache &) = delete;
+    SimpleIconCache & operator=(const SimpleIconCache &) = delete;
+
+    /**
+     * Get the decoded icon of a file, loading it on a miss. Icons that
+     * failed to load are returned (check SimpleIcon::error()) but not
+     * cached.
+     * @param file Path of the image datafile
+     * @return Handle to the icon, never empty
+     * @throws whatever the loader throws, e.g. std::bad_alloc
+     */
+    Handle get(const string &file);
+
+    /**
+     * Drop the entry of a file, if any.
+     * @param file Path of the image datafile
+     */
+    void invalidate(const string &file);
+
+    /**
+     * Drop all entries.
+     */
+    void clear();
+
+    /**
+     * Change the byte budget, evicting entries if necessary.
+     * @param budget Upper limit for the size of all entries in bytes
+     */
+    void setBudget(size_t budget);
+    size_t budget() const;
+
+    Stats stats() const;
+    void resetStats();
+
+    /**
+     * Bytes an icon is accounted with.
+     */
+    static size_t costOf(const SimpleIcon &icon);
+
+private:
+    /**
+     * File state an entry was loaded from.
+     */
+    struct Stamp
+    {
+        int64_t seconds;
+        long nanoseconds;
+        int64_t size;
+
+        bool operator==(const Stamp &other) const
+        {
+            return seconds == other.seconds && nanoseconds == other.nanoseconds &&
+                   size == other.size;
+        }
+    };
+
+    struct Entry
+    {
+        string file;
+        Stamp stamp;
+        Handle icon;
+        size_t bytes;
+    };
+
+    typedef std::list<Entry> Lru;
+
+    mutable std::mutex mMutex;
+    size_t mBudget;
+    Loader mLoader;
+    Lru mLru;   ///< most recently used first
+    std::unordered_map<string, Lru::iterator> mIndex;
+    std::unordered_map<string, std::shared_future<Handle>> mLoading;
+    Stats mStats;
+
+    static bool stampOf(const string &file, Stamp &stamp);
+    void erase(Lru::iterator entry);
+    void evict();
+};
+
+#endif
@@ -0,0 +1,124 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SimpleIconStats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+struct AtomicCounter
+{
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> nanoseconds;
+    std::atomic<uint64_t> bytes;
+};
+
+AtomicCounter sStages[SimpleIconStats::STAGE_COUNT];
+std::atomic<uint64_t> sAllocations(0);
+std::atomic<uint64_t> sAllocatedBytes(0);
+
+uint64_t now()
+{
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}
+
+SimpleIconStats::Timer::Timer(Stage stage, uint64_t bytes) :
+    mStage(stage), mBytes(bytes), mStart(now())
+{
+}
+
+SimpleIconStats::Timer::~Timer()
+{
+    record(mStage, now() - mStart, mBytes);
+}
+
+SimpleIconStats::Snapshot SimpleIconStats::snapshot()
+{
+    Snapshot snapshot;
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        snapshot.stages[i].calls = sStages[i].calls.load(std::memory_order_relaxed);
+        snapshot.stages[i].nanoseconds = sStages[i].nanoseconds.load(std::memory_order_relaxed);
+        snapshot.stages[i].bytes = sStages[i].bytes.load(std::memory_order_relaxed);
+    }
+    snapshot.allocations = sAllocations.load(std::memory_order_relaxed);
+    snapshot.allocatedBytes = sAllocatedBytes.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void SimpleIconStats::reset()
+{
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        sStages[i].calls = 0;
+        sStages[i].nanoseconds = 0;
+        sStages[i].bytes = 0;
+    }
+    sAllocations = 0;
+    sAllocatedBytes = 0;
+}
+
+void SimpleIconStats::record(Stage stage, uint64_t nanoseconds, uint64_t bytes)
+{
+    sStages[stage].calls.fetch_add(1, std::memory_order_relaxed);
+    sStages[stage].nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+    sStages[stage].bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void SimpleIconStats::recordAllocation(uint64_t bytes)
+{
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    sAllocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+const char * SimpleIconStats::stageName(Stage stage)
+{
+    static const char *NAMES[STAGE_COUNT] = {
+        "io", "header", "decode", "render", "output", "encode"
+    };
+    return (stage >= 0 && stage < STAGE_COUNT) ? NAMES[stage] : "unknown";
+}
+
+void SimpleIconStats::print(std::ostream &out, const Snapshot &snapshot)
+{
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-8s %10s %14s %14s\n",
+                  "stage", "calls", "ns", "bytes");
+    out << line;
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        const Counter &c = snapshot.stages[i];
+        std::snprintf(line, sizeof(line), "%-8s %10llu %14llu %14llu\n",
+                      stageName(Stage(i)), (unsigned long long) c.calls,
+                      (unsigned long long) c.nanoseconds,
+                      (unsigned long long) c.bytes);
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "%-8s %10llu %14s %14llu\n", "alloc",
+                  (unsigned long long) snapshot.allocations, "",
+                  (unsigned long long) snapshot.allocatedBytes);
+    out << line;
+}
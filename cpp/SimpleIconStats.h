@@ -0,0 +1,130 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIMPLEICONSTATS_H
+#define SIMPLEICONSTATS_H
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Optional per-stage timing counters for the SimpleIcon pipeline.
+ *
+ * Compiled in only when SIMPLEICON_STATS is defined (make build STATS=1).
+ * Otherwise the SIMPLEICON_STAGE / SIMPLEICON_ALLOCATION macros expand to
+ * nothing and snapshot() stays all zero, so the pipeline pays nothing.
+ * Counters are process wide and safe to update from several threads.
+ */
+class SimpleIconStats
+{
+public:
+    /**
+     * Pipeline stages that are measured.
+     */
+    enum Stage {
+        IO = 0,         ///< opening and mapping / reading files
+        HEADER = 1,     ///< splitting and validating the header fields
+        DECODE = 2,     ///< decoding pixel data
+        RENDER = 3,     ///< rendering "ascii art" into a buffer
+        OUTPUT = 4,     ///< writing rendered frames
+        ENCODE = 5,     ///< encoding pixels for saving
+        STAGE_COUNT = 6
+    };
+
+    /**
+     * Totals of one stage.
+     */
+    struct Counter
+    {
+        uint64_t calls;
+        uint64_t nanoseconds;
+        uint64_t bytes;
+    };
+
+    /**
+     * Copy of all counters at one point in time.
+     */
+    struct Snapshot
+    {
+        Counter stages[STAGE_COUNT];
+        uint64_t allocations;
+        uint64_t allocatedBytes;
+    };
+
+    /**
+     * Measures the lifetime of a scope as one call of a stage.
+     */
+    class Timer
+    {
+    public:
+        Timer(Stage stage, uint64_t bytes);
+        ~Timer();
+
+        /**
+         * Account bytes that are only known once the stage has run.
+         */
+        void addBytes(uint64_t bytes) { mBytes += bytes; }
+
+    private:
+        Stage mStage;
+        uint64_t mBytes;
+        uint64_t mStart;
+    };
+
+    /**
+     * Whether the counters are compiled in.
+     */
+    static constexpr bool enabled()
+    {
+#ifdef SIMPLEICON_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static Snapshot snapshot();
+    static void reset();
+    static void record(Stage stage, uint64_t nanoseconds, uint64_t bytes);
+    static void recordAllocation(uint64_t bytes);
+    static const char * stageName(Stage stage);
+
+    /**
+     * Print a snapshot as a table.
+     */
+    static void print(std::ostream &out, const Snapshot &snapshot);
+};
+
+#ifdef SIMPLEICON_STATS
+// One timer per scope; an inner scope may open another stage.
+#define SIMPLEICON_STAGE(stage, bytes) \
+    SimpleIconStats::Timer simpleIconStageTimer(SimpleIconStats::stage, uint64_t(bytes))
+#define SIMPLEICON_STAGE_BYTES(bytes) simpleIconStageTimer.addBytes(uint64_t(bytes))
+#define SIMPLEICON_ALLOCATION(bytes) SimpleIconStats::recordAllocation(uint64_t(bytes))
+#else
+#define SIMPLEICON_STAGE(stage, bytes) do { } while (0)
+#define SIMPLEICON_STAGE_BYTES(bytes) do { } while (0)
+#define SIMPLEICON_ALLOCATION(bytes) do { } while (0)
+#endif
+
+#endif
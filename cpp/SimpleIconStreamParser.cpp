@@ -0,0 +1,342 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SimpleIconStreamParser.h"
+#include "PixelDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <iostream>
+using std::endl;
+
+void SimpleIconStreamParser::Listener::fieldParsed(int, string_view)
+{
+}
+
+void SimpleIconStreamParser::Listener::headerParsed(const string &, int, int, int)
+{
+}
+
+void SimpleIconStreamParser::Listener::rowDecoded(int, const uint64_t *)
+{
+}
+
+void SimpleIconStreamParser::Listener::blockDecoded(int, int, int, const uint8_t *)
+{
+}
+
+SimpleIconStreamParser::SimpleIconStreamParser(Listener *listener, bool keepPixels) :
+    mListener(listener), mKeepPixels(keepPixels)
+{
+    reset();
+}
+
+void SimpleIconStreamParser::reset()
+{
+    mState = HEADER;
+    mError = SimpleIcon::Error::NO_ERROR;
+    mField = 0;
+    mBuffer.clear();
+    mPendingDelim = false;
+    mName.clear();
+    mFileVersion = 0;
+    mWidth = 0;
+    mHeight = 0;
+    mPixels.clear();
+    mRowBits.clear();
+    mCarryLength = 0;
+    mRow = 0;
+    mCol = 0;
+    mBlock = 0;
+}
+
+int SimpleIconStreamParser::feed(const char *data, size_t length)
+{
+    const char *end = data + length;
+
+    if (mState == HEADER) {
+        feedHeader(data, end);
+    }
+
+    // Digits are handed on line by line so line breaks never reach the
+    // decoder.
+    while (mState == DATA && data < end) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(data, '\n', end - data));
+        const char *segmentEnd = lineEnd ? lineEnd : end;
+        size_t count = segmentEnd - data;
+        if (count > 0 && data[count - 1] == '\r') {
+            --count;
+        }
+        feedDigits(data, count);
+        data = lineEnd ? lineEnd + 1 : end;
+    }
+
+    return mError;
+}
+
+int SimpleIconStreamParser::finish()
+{
+    if (mState == HEADER) {
+        return fail("Input file has illegal format (expect 4 fields)");
+    }
+    if (mState == DATA) {
+        // Digits of a truncated unit still count, the missing ones are 0.
+        if (mCarryLength > 0) {
+            int unit = unitSize();
+            std::memset(mCarry + mCarryLength, '0', unit - mCarryLength);
+            mCarryLength = 0;
+            decodeUnit(mCarry, unit);
+        }
+        if (mFileVersion == 1 && mCol > 0 && mState == DATA) {
+            std::fill(mRowBits.begin() + (mCol >> 6), mRowBits.end(), 0);
+            finishRow();
+        }
+        mState = DONE;
+    }
+    return mError;
+}
+
+SimpleIcon SimpleIconStreamParser::takeIcon()
+{
+    return SimpleIcon(mName, mFileVersion, std::move(mPixels));
+}
+
+int SimpleIconStreamParser::fail(const char *message)
+{
+    std::cerr << message << endl;
+    mState = FAILED;
+    mError = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+    return mError;
+}
+
+void SimpleIconStreamParser::feedHeader(const char *&data, const char *end)
+{
+    const char delim = SimpleIcon::DELIM[0];
+
+    while (data < end && mState == HEADER) {
+        char c = *data++;
+        if (c == '\n' || c == '\r') {
+            continue;
+        }
+
+        if (mPendingDelim) {
+            mPendingDelim = false;
+            if (c == SimpleIcon::DELIM[1]) {
+                finishField();
+                continue;
+            }
+            mBuffer += delim;
+        }
+
+        if (c == delim) {
+            mPendingDelim = true;
+        } else if (mBuffer.size() < MAX_FIELD_LENGTH) {
+            mBuffer += c;
+        } else {
+            fail("Header field exceeds maximum length");
+        }
+    }
+}
+
+int SimpleIconStreamParser::finishField()
+{
+    if (mListener) {
+        mListener->fieldParsed(mField, mBuffer);
+    }
+
+    int error = SimpleIcon::Error::NO_ERROR;
+    switch (mField) {
+    case 0:
+        mName = mBuffer;
+        break;
+    case 1:
+        error = SimpleIcon::parseVersion(mBuffer, mFileVersion);
+        break;
+    case 2:
+        error = SimpleIcon::parseSize(mBuffer, mWidth, mHeight);
+        break;
+    }
+    mBuffer.clear();
+
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        mState = FAILED;
+        mError = error;
+        return mError;
+    }
+
+    if (++mField < 3) {
+        return mError;
+    }
+
+    if (mFileVersion != 1 && mFileVersion != 2) {
+        return fail("Unsupported file version");
+    }
+    if (mWidth <= 0 || mHeight <= 0) {
+        return fail("Illegal image size");
+    }
+    if (mKeepPixels && !mPixels.reset(mWidth, mHeight)) {
+        return fail("Unable to allocate image data");
+    }
+
+    mRowBits.assign(Bitplane::strideFor(mWidth), 0);
+    mState = DATA;
+    if (mListener) {
+        mListener->headerParsed(mName, mFileVersion, mWidth, mHeight);
+    }
+    return mError;
+}
+
+void SimpleIconStreamParser::feedDigits(const char *data, size_t length)
+{
+    while (length > 0 && mState == DATA) {
+        int unit = unitSize();
+
+        if (mCarryLength == 0 && length >= size_t(unit)) {
+            decodeUnit(data, unit);
+            data += unit;
+            length -= unit;
+            continue;
+        }
+
+        // Unit split across chunks: collect it in the carry buffer.
+        size_t take = unit - mCarryLength;
+        if (take > length) {
+            take = length;
+        }
+        std::memcpy(mCarry + mCarryLength, data, take);
+        mCarryLength += int(take);
+        data += take;
+        length -= take;
+
+        if (mCarryLength == unit) {
+            mCarryLength = 0;
+            decodeUnit(mCarry, unit);
+        }
+    }
+}
+
+int SimpleIconStreamParser::unitSize() const
+{
+    if (mFileVersion == 1) {
+        int count = mWidth - mCol;
+        return count < 64 ? count : 64;
+    }
+
+    // Full version 2 blocks are decoded 8 rows (64 digits) at a time.
+    int blockWidth = mWidth - 8 * mBlock;
+    if (blockWidth < 8) {
+        return blockWidth;
+    }
+    int rows = mHeight - mRow;
+    return 8 * (rows < 8 ? rows : 8);
+}
+
+void SimpleIconStreamParser::decodeUnit(const char *digits, int count)
+{
+    uint64_t bits = (count == 64) ? PixelDecoder::pack64(digits)
+                                  : PixelDecoder::packScalar(digits, count);
+
+    if (mFileVersion == 1) {
+        mRowBits[mCol >> 6] = bits;
+        mCol += count;
+        if (mCol == mWidth) {
+            finishRow();
+        }
+        return;
+    }
+
+    int blockWidth = mWidth - 8 * mBlock;
+    int rows = blockWidth < 8 ? 1 : count / 8;
+    uint8_t bytes[8];
+    for (int k = 0; k < rows; ++k) {
+        bytes[k] = uint8_t(bits >> (8 * k));
+        if (mKeepPixels) {
+            mPixels.orBlock(mBlock, mRow + k, bytes[k]);
+        }
+    }
+    if (mListener) {
+        mListener->blockDecoded(mBlock, mRow, rows, bytes);
+    }
+
+    mRow += rows;
+    if (mRow == mHeight) {
+        mRow = 0;
+        if (8 * ++mBlock >= mWidth) {
+            mState = DONE;
+        }
+    }
+}
+
+void SimpleIconStreamParser::finishRow()
+{
+    if (mKeepPixels) {
+        std::memcpy(mPixels.row(mRow), mRowBits.data(),
+                    mRowBits.size() * sizeof(uint64_t));
+    }
+    if (mListener) {
+        mListener->rowDecoded(mRow, mRowBits.data());
+    }
+    mCol = 0;
+    if (++mRow == mHeight) {
+        mState = DONE;
+    }
+}
+
+// GETTER
+
+bool SimpleIconStreamParser::headerComplete() const
+{
+    return mField >= 3 && mState != FAILED;
+}
+
+bool SimpleIconStreamParser::complete() const
+{
+    return mState == DONE;
+}
+
+int SimpleIconStreamParser::error() const
+{
+    return mError;
+}
+
+const string & SimpleIconStreamParser::name() const
+{
+    return mName;
+}
+
+int SimpleIconStreamParser::fileVersion() const
+{
+    return mFileVersion;
+}
+
+int SimpleIconStreamParser::width() const
+{
+    return mWidth;
+}
+
+int SimpleIconStreamParser::height() const
+{
+    return mHeight;
+}
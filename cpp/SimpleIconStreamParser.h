@@ -0,0 +1,174 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SIMPLEICONSTREAMPARSER_H
+#define SIMPLEICONSTREAMPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+#include "SimpleIcon.h"
+
+/**
+ * Push style parser for image datafiles arriving in arbitrary chunks.
+ *
+ * Header fields are reported as soon as their delimiter has been seen and
+ * pixel data is decoded while it flows in: complete rows for version 1,
+ * runs of up to 8 rows of a column block for version 2. Apart from the
+ * optional decoded bitplane the parser only keeps one header field, one
+ * row and less than 64 pending digits, no matter how large the payload.
+ */
+class SimpleIconStreamParser
+{
+public:
+    /**
+     * Receives parse events. All methods have empty default implementations.
+     */
+    class Listener
+    {
+    public:
+        virtual ~Listener() {}
+
+        /**
+         * A header field is complete.
+         * @param field Field position, 0 (name) to 2 (size)
+         * @param value Raw content of the field
+         */
+        virtual void fieldParsed(int field, string_view value);
+
+        /**
+         * All header fields are parsed and valid, pixel data follows.
+         */
+        virtual void headerParsed(const string &name, int fileVersion,
+                                  int width, int height);
+
+        /**
+         * A version 1 row is complete.
+         * @param row Index of the row
+         * @param bits Row in Bitplane layout, Bitplane::strideFor(width) words
+         */
+        virtual void rowDecoded(int row, const uint64_t *bits);
+
+        /**
+         * Rows of a version 2 column block are complete.
+         * @param block Index of the block, it covers columns 8 * block and up
+         * @param firstRow First row contained in bits
+         * @param rowCount Number of rows contained in bits
+         * @param bits One byte per row, bit i is column 8 * block + i
+         */
+        virtual void blockDecoded(int block, int firstRow, int rowCount,
+                                  const uint8_t *bits);
+    };
+
+    /** Longest accepted header field, bounds the header buffer. */
+    static const size_t MAX_FIELD_LENGTH = 4096;
+
+    /**
+     * Construct a parser ready for the first chunk.
+     * @param listener Optional receiver of parse events, not owned
+     * @param keepPixels Whether to collect the pixels for takeIcon()
+     */
+    explicit SimpleIconStreamParser(Listener *listener = 0, bool keepPixels = true);
+
+    /**
+     * Process the next chunk of file content. Line breaks are ignored and
+     * anything after the last pixel is skipped.
+     * @param data Start of the chunk
+     * @param length Length of the chunk in bytes
+     * @return Some value from SimpleIcon::Error, the error is sticky
+     */
+    int feed(const char *data, size_t length);
+
+    /**
+     * Signal the end of the input. A payload shorter than the image leaves
+     * the remaining pixels cleared, like SimpleIcon::loadFromFile does.
+     * @return Some value from SimpleIcon::Error
+     */
+    int finish();
+
+    /**
+     * Forget all state and prepare for a new file.
+     */
+    void reset();
+
+    /**
+     * Move the collected image into a SimpleIcon. Only meaningful after
+     * finish() succeeded with keepPixels enabled.
+     */
+    SimpleIcon takeIcon();
+
+    // GETTER
+    bool headerComplete() const;
+    bool complete() const;
+    int error() const;
+    const string & name() const;
+    int fileVersion() const;
+    int width() const;
+    int height() const;
+
+private:
+    enum State {
+        HEADER,
+        DATA,
+        DONE,
+        FAILED
+    };
+
+    Listener *mListener;
+    bool mKeepPixels;
+
+    State mState;
+    int mError;
+    int mField;
+    string mBuffer;
+    bool mPendingDelim;
+
+    string mName;
+    int mFileVersion;
+    int mWidth;
+    int mHeight;
+    Bitplane mPixels;
+
+    std::vector<uint64_t> mRowBits;
+    char mCarry[64];
+    int mCarryLength;
+    int mRow;
+    int mCol;
+    int mBlock;
+
+    int fail(const char *message);
+    void feedHeader(const char *&data, const char *end);
+    int finishField();
+    void feedDigits(const char *data, size_t length);
+    int unitSize() const;
+    void decodeUnit(const char *digits, int count);
+    void finishRow();
+};
+
+#endif
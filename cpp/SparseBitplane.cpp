@@ -0,0 +1,241 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SparseBitplane.h"
+#include "PixelDecoder.h"
+#include "SimpleIcon.h"
+
+#include <iostream>
+using std::endl;
+
+namespace {
+
+int illegal(const char *message)
+{
+    std::cerr << message << endl;
+    return SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Mask of the tile pixels lying inside an image of the given size.
+ */
+uint64_t insideMask(int tx, int ty, int width, int height)
+{
+    int cols = width - tx * SparseBitplane::TILE_SIZE;
+    int rows = height - ty * SparseBitplane::TILE_SIZE;
+    uint64_t rowMask = cols >= 8 ? 0xff : (uint64_t(1) << cols) - 1;
+    uint64_t mask = 0;
+    for (int k = 0; k < 8 && k < rows; ++k) {
+        mask |= rowMask << (8 * k);
+    }
+    return mask;
+}
+
+}
+
+SparseBitplane::SparseBitplane() :
+    SparseBitplane(0, 0)
+{
+}
+
+SparseBitplane::SparseBitplane(int width, int height) :
+    mWidth(width), mHeight(height),
+    mTilesX((width + TILE_SIZE - 1) / TILE_SIZE),
+    mTilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+    mOccupancy((size_t(mTilesX) * size_t(mTilesY) + 63) / 64, 0),
+    mRank(mOccupancy.size(), 0), mTiles()
+{
+}
+
+SparseBitplane SparseBitplane::fromBitplane(const Bitplane &pixels)
+{
+    SparseBitplane tiles(pixels.width(), pixels.height());
+
+    for (int ty = 0; ty < tiles.mTilesY; ++ty) {
+        const int rows = (pixels.height() - ty * TILE_SIZE < TILE_SIZE)
+                         ? pixels.height() - ty * TILE_SIZE : TILE_SIZE;
+        for (int tx = 0; tx < tiles.mTilesX; ++tx) {
+            uint64_t bits = 0;
+            for (int k = 0; k < rows; ++k) {
+                uint64_t word = pixels.row(ty * TILE_SIZE + k)[tx >> 3];
+                bits |= ((word >> ((tx & 7) * 8)) & 0xff) << (8 * k);
+            }
+            if (bits) {
+                size_t index = size_t(ty) * tiles.mTilesX + tx;
+                tiles.mOccupancy[index >> 6] |= uint64_t(1) << (index & 63);
+                tiles.mTiles.push_back(bits);
+            }
+        }
+    }
+
+    tiles.updateRank();
+    return tiles;
+}
+
+Bitplane SparseBitplane::toBitplane() const
+{
+    Bitplane pixels(mWidth, mHeight);
+    if (pixels.empty()) {
+        return pixels;
+    }
+
+    forEachTile([&](int tx, int ty, uint64_t bits) {
+        for (int k = 0; k < TILE_SIZE && ty * TILE_SIZE + k < mHeight; ++k) {
+            pixels.orBlock(tx, ty * TILE_SIZE + k, bits >> (8 * k));
+        }
+    });
+    return pixels;
+}
+
+int SparseBitplane::decode(string_view payload, int width, int height, SparseBitplane &tiles)
+{
+    tiles = SparseBitplane(width, height);
+
+    const size_t tileCount = size_t(tiles.mTilesX) * size_t(tiles.mTilesY);
+    if (payload.size() < tileCount + 1 || payload[tileCount] != SECTION_DELIM) {
+        return illegal("Tile occupancy bitmap does not match the image size");
+    }
+
+    const char *digits = payload.data();
+    for (size_t index = 0; index < tileCount; ++index) {
+        if (digits[index] != '0' && digits[index] != '1') {
+            return illegal("Illegal character in tile occupancy bitmap");
+        }
+    }
+    for (size_t word = 0; word < tiles.mOccupancy.size(); ++word) {
+        size_t count = tileCount - word * 64;
+        tiles.mOccupancy[word] = (count >= 64)
+                                 ? PixelDecoder::pack64(digits + word * 64)
+                                 : PixelDecoder::packScalar(digits + word * 64, int(count));
+    }
+    tiles.updateRank();
+
+    size_t occupied = tiles.mRank.empty() ? 0 : tiles.mRank.back()
+                      + size_t(__builtin_popcountll(tiles.mOccupancy.back()));
+    string_view hex = payload.substr(tileCount + 1);
+    if (hex.size() != occupied * 16) {
+        return illegal("Tile data does not match the occupancy bitmap");
+    }
+
+    tiles.mTiles.resize(occupied);
+    size_t next = 0;
+    int error = SimpleIcon::Error::NO_ERROR;
+    tiles.forEachTile([&](int tx, int ty, uint64_t) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 16; ++i) {
+            int value = hexValue(hex[next * 16 + i]);
+            if (value < 0) {
+                error = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+            }
+            bits = (bits << 4) | uint64_t(value & 0xf);
+        }
+        // Pixels outside the image must not leak into the tile.
+        tiles.mTiles[next++] = bits & insideMask(tx, ty, width, height);
+    });
+
+    if (error != SimpleIcon::Error::NO_ERROR) {
+        return illegal("Illegal character in tile data");
+    }
+    return SimpleIcon::Error::NO_ERROR;
+}
+
+string SparseBitplane::encode() const
+{
+    static const char HEX[] = "0123456789abcdef";
+    const size_t tileCount = size_t(mTilesX) * size_t(mTilesY);
+
+    string payload;
+    payload.reserve(tileCount + 1 + mTiles.size() * 16);
+    for (size_t index = 0; index < tileCount; ++index) {
+        payload += ((mOccupancy[index >> 6] >> (index & 63)) & 1) ? '1' : '0';
+    }
+    payload += SECTION_DELIM;
+
+    for (uint64_t bits : mTiles) {
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            payload += HEX[(bits >> shift) & 0xf];
+        }
+    }
+    return payload;
+}
+
+bool SparseBitplane::get(int x, int y) const
+{
+    uint64_t bits = tile(x / TILE_SIZE, y / TILE_SIZE);
+    return (bits >> ((y % TILE_SIZE) * 8 + (x % TILE_SIZE))) & 1;
+}
+
+uint64_t SparseBitplane::tile(int tx, int ty) const
+{
+    size_t index = size_t(ty) * mTilesX + tx;
+    uint64_t word = mOccupancy[index >> 6];
+    uint64_t bit = uint64_t(1) << (index & 63);
+    if (!(word & bit)) {
+        return 0;
+    }
+    return mTiles[mRank[index >> 6] + __builtin_popcountll(word & (bit - 1))];
+}
+
+bool SparseBitplane::occupied(int tx, int ty) const
+{
+    size_t index = size_t(ty) * mTilesX + tx;
+    return (mOccupancy[index >> 6] >> (index & 63)) & 1;
+}
+
+size_t SparseBitplane::count() const
+{
+    size_t total = 0;
+    for (uint64_t bits : mTiles) {
+        total += size_t(__builtin_popcountll(bits));
+    }
+    return total;
+}
+
+size_t SparseBitplane::sizeInBytes() const
+{
+    return (mOccupancy.size() + mTiles.size()) * sizeof(uint64_t)
+         + mRank.size() * sizeof(uint32_t);
+}
+
+void SparseBitplane::updateRank()
+{
+    uint32_t rank = 0;
+    for (size_t word = 0; word < mOccupancy.size(); ++word) {
+        mRank[word] = rank;
+        rank += uint32_t(__builtin_popcountll(mOccupancy[word]));
+    }
+}
@@ -0,0 +1,153 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SPARSEBITPLANE_H
+#define SPARSEBITPLANE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+
+/**
+ * Image stored as 8x8 pixel tiles of which only the non-empty ones are
+ * kept, plus an occupancy bitmap with one bit per tile.
+ *
+ * A tile is one 64 bit word: byte k holds tile row k, bit i of a byte is
+ * tile column i (the same bit order as Bitplane). A SparseBitplane of a
+ * mostly empty mask is small, and its count() / forEachTile() never touch
+ * empty tiles.
+ *
+ * This is also the version 4 payload: the occupancy bitmap as '0'/'1'
+ * digits (row by row of tiles), a ':' and then every non-empty tile as 16
+ * hex digits in the same order. SimpleIcon uses it only as that codec:
+ * version 4 icons are expanded into a dense Bitplane when loaded, like
+ * every other version, so their operations do not skip empty tiles.
+ */
+class SparseBitplane
+{
+public:
+    /** Edge length of a tile in pixels. */
+    static const int TILE_SIZE = 8;
+
+    /** Separator between occupancy bitmap and tiles in payloads. */
+    static const char SECTION_DELIM = ':';
+
+    /**
+     * Construct an empty image of size 0x0.
+     */
+    SparseBitplane();
+
+    /**
+     * Construct an image of the given size with all pixels cleared.
+     */
+    SparseBitplane(int width, int height);
+
+    /**
+     * Build the tiled form of a dense image.
+     */
+    static SparseBitplane fromBitplane(const Bitplane &pixels);
+
+    /**
+     * Expand into a dense image.
+     */
+    Bitplane toBitplane() const;
+
+    /**
+     * Decode a version 4 payload.
+     * @param payload Data field of the file
+     * @param width Image width
+     * @param height Image height
+     * @param tiles Receives the image
+     * @return Some value from SimpleIcon::Error
+     */
+    static int decode(string_view payload, int width, int height, SparseBitplane &tiles);
+
+    /**
+     * Encode as version 4 payload.
+     */
+    string encode() const;
+
+    /**
+     * Read a single pixel. Coordinates are not range checked.
+     */
+    bool get(int x, int y) const;
+
+    /**
+     * Tile content, 0 for empty tiles.
+     * @param tx Tile column
+     * @param ty Tile row
+     */
+    uint64_t tile(int tx, int ty) const;
+
+    /**
+     * Whether a tile holds any set pixel.
+     */
+    bool occupied(int tx, int ty) const;
+
+    /**
+     * Number of set pixels, only occupied tiles are visited.
+     */
+    size_t count() const;
+
+    /**
+     * Call f(tx, ty, bits) for every non-empty tile in row major order.
+     */
+    template<typename F>
+    void forEachTile(F f) const
+    {
+        size_t next = 0;
+        for (size_t word = 0; word < mOccupancy.size(); ++word) {
+            for (uint64_t bits = mOccupancy[word]; bits; bits &= bits - 1) {
+                size_t index = word * 64 + size_t(__builtin_ctzll(bits));
+                f(int(index % mTilesX), int(index / mTilesX), mTiles[next++]);
+            }
+        }
+    }
+
+    // GETTER
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int tilesX() const { return mTilesX; }
+    int tilesY() const { return mTilesY; }
+    size_t occupiedTiles() const { return mTiles.size(); }
+    size_t sizeInBytes() const;
+
+private:
+    int mWidth;
+    int mHeight;
+    int mTilesX;
+    int mTilesY;
+    std::vector<uint64_t> mOccupancy;
+    std::vector<uint32_t> mRank;
+    std::vector<uint64_t> mTiles;
+
+    void updateRank();
+};
+
+#endif
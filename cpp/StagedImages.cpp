@@ -0,0 +1,122 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "StagedImages.h"
+#include "SimpleIcon.h"
+
+#include <cstring>
+
+namespace {
+
+bool samePixels(const Bitplane &a, const Bitplane &b)
+{
+    return a.width() == b.width() && a.height() == b.height()
+        && std::memcmp(a.words(), b.words(), a.sizeInBytes()) == 0;
+}
+
+}
+
+StagedImages::StagedImages() :
+    mIcons(), mImages(), mImagesByHash(), mNames()
+{
+}
+
+bool StagedImages::add(const SimpleIcon &icon, string_view name)
+{
+    if (name.empty()) {
+        name = icon.name();
+    }
+    const Bitplane &pixels = icon.pixels();
+    if (pixels.empty() || !mNames.insert(string(name)).second) {
+        return false;
+    }
+
+    const uint64_t hash = pixels.hash();
+    size_t image = mImages.size();
+    auto range = mImagesByHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (samePixels(mImages[it->second], pixels)) {
+            image = it->second;
+            break;
+        }
+    }
+    if (image == mImages.size()) {
+        mImages.push_back(pixels);
+        mImagesByHash.emplace(hash, image);
+    }
+
+    mIcons.push_back(Icon{ string(name), icon.fileVersion(), image });
+    return true;
+}
+
+void StagedImages::clear()
+{
+    mIcons.clear();
+    mImages.clear();
+    mImagesByHash.clear();
+    mNames.clear();
+}
+
+const std::vector<StagedImages::Icon> & StagedImages::icons() const
+{
+    return mIcons;
+}
+
+const std::vector<Bitplane> & StagedImages::images() const
+{
+    return mImages;
+}
+
+size_t StagedImages::size() const
+{
+    return mIcons.size();
+}
+
+std::vector<uint32_t> StagedImages::nameSlots() const
+{
+    uint32_t count = 2;
+    while (count < 2 * mIcons.size()) {
+        count *= 2;
+    }
+
+    std::vector<uint32_t> slots(count, 0);
+    for (size_t i = 0; i < mIcons.size(); ++i) {
+        uint32_t s = uint32_t(hashName(mIcons[i].name)) & (count - 1);
+        while (slots[s]) {
+            s = (s + 1) & (count - 1);
+        }
+        slots[s] = uint32_t(i + 1);
+    }
+    return slots;
+}
+
+uint64_t StagedImages::hashName(string_view name)
+{
+    uint64_t hash = Bitplane::hashBytes(name.data(), name.size());
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
@@ -0,0 +1,121 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef STAGEDIMAGES_H
+#define STAGEDIMAGES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+using std::string;
+using std::string_view;
+
+#include "Bitplane.h"
+
+class SimpleIcon;
+
+/**
+ * Icons collected for an IconAtlas or a SharedIconStore, before they are
+ * written out.
+ *
+ * Names are unique. Icons with identical pixels share one image: added
+ * images are hashed (Bitplane::hash) and compared word by word on a hash
+ * match.
+ */
+class StagedImages
+{
+public:
+    /**
+     * A staged icon.
+     */
+    struct Icon
+    {
+        string name;
+        int fileVersion;
+        size_t image;   ///< index into images()
+    };
+
+    /**
+     * Construct an empty set.
+     */
+    StagedImages();
+
+    /**
+     * Stage an icon.
+     * @param icon Icon to add
+     * @param name Name to file the icon under, the icon's own name if
+     * empty; must not have been added before
+     * @return true if the icon was added
+     */
+    bool add(const SimpleIcon &icon, string_view name = string_view());
+
+    /**
+     * Forget all staged icons.
+     */
+    void clear();
+
+    /**
+     * Staged icons, in the order they were added.
+     */
+    const std::vector<Icon> & icons() const;
+
+    /**
+     * Distinct images of the staged icons.
+     */
+    const std::vector<Bitplane> & images() const;
+
+    /**
+     * Number of staged icons.
+     */
+    size_t size() const;
+
+    /**
+     * Open addressing hash table of the staged names, as stored by
+     * IconAtlas and SharedIconStore: a power of two number of slots, at
+     * least twice the icons, each holding an icon index + 1 or 0 for a free
+     * slot. Lookups probe onwards from slot hashName(name) & (slots - 1).
+     * @return the slots
+     */
+    std::vector<uint32_t> nameSlots() const;
+
+    /**
+     * Hash of a name for the slot table. The low bits of Bitplane::hashBytes
+     * depend little on the last bytes, e.g. the numbers of "icon12" and
+     * "icon13", so they get the murmur3 64 bit finalizer on top.
+     * @param name Name to hash
+     * @return the hash
+     */
+    static uint64_t hashName(string_view name);
+
+private:
+    std::vector<Icon> mIcons;
+    std::vector<Bitplane> mImages;  ///< distinct images of mIcons
+    std::unordered_multimap<uint64_t, size_t> mImagesByHash;
+    std::unordered_set<string> mNames;
+};
+
+#endif
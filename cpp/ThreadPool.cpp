@@ -0,0 +1,184 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ThreadPool.h"
+
+namespace {
+
+/** Set on pool threads and while the caller takes part in a run. */
+thread_local bool sInsidePool = false;
+
+}
+
+ThreadPool::ThreadPool(unsigned threads) :
+    mTask(0), mGrain(1), mGeneration(0), mActive(0), mStop(false)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    mRanges.reset(new Range[threads]);
+    for (unsigned i = 0; i + 1 < threads; ++i) {
+        mThreads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    for (std::thread &thread : mThreads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const Task &task, size_t grain)
+{
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    if (mThreads.empty() || sInsidePool || count <= grain) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            task(begin, (count - begin < grain) ? count : begin + grain);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(mCallMutex);
+    const size_t slots = size();
+    for (size_t i = 0; i < slots; ++i) {
+        std::lock_guard<std::mutex> lock(mRanges[i].lock);
+        mRanges[i].begin = count * i / slots;
+        mRanges[i].end = count * (i + 1) / slots;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mGrain = grain;
+        mActive = unsigned(mThreads.size());
+        ++mGeneration;
+    }
+    mWake.notify_all();
+
+    // The caller works on the last slot.
+    sInsidePool = true;
+    runSlot(unsigned(slots - 1));
+    sInsidePool = false;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this] { return mActive == 0; });
+    mTask = 0;
+}
+
+unsigned ThreadPool::size() const
+{
+    return unsigned(mThreads.size()) + 1;
+}
+
+ThreadPool & ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop(unsigned slot)
+{
+    sInsidePool = true;
+    unsigned seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this, seen] { return mStop || mGeneration != seen; });
+            if (mStop) {
+                return;
+            }
+            seen = mGeneration;
+        }
+
+        runSlot(slot);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mActive == 0) {
+            mDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::runSlot(unsigned slot)
+{
+    size_t begin, end;
+    while (take(slot, begin, end) || (steal(slot) && take(slot, begin, end))) {
+        (*mTask)(begin, end);
+    }
+}
+
+bool ThreadPool::take(unsigned slot, size_t &begin, size_t &end)
+{
+    Range &own = mRanges[slot];
+    std::lock_guard<std::mutex> lock(own.lock);
+    if (own.begin >= own.end) {
+        return false;
+    }
+
+    begin = own.begin;
+    end = (own.end - begin > mGrain) ? begin + mGrain : own.end;
+    own.begin = end;
+    return true;
+}
+
+bool ThreadPool::steal(unsigned slot)
+{
+    const unsigned slots = size();
+    for (unsigned i = 1; i < slots; ++i) {
+        Range &victim = mRanges[(slot + i) % slots];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.lock);
+            if (victim.begin >= victim.end) {
+                continue;
+            }
+            // Leave the front half to the owner, take the back half.
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+
+        Range &own = mRanges[slot];
+        std::lock_guard<std::mutex> lock(own.lock);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,111 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running index ranges in parallel.
+ *
+ * parallelFor() splits the index space evenly over all workers plus the
+ * calling thread. A participant that runs out of work steals the back half
+ * of the remaining range of another one, so uneven costs per index (e.g.
+ * icons of very different sizes) still keep every core busy.
+ *
+ * Calls from inside a task run serially on the calling thread instead of
+ * deadlocking, so code using the pool can be nested safely.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * Function processing the indices [begin, end).
+     */
+    typedef std::function<void(size_t begin, size_t end)> Task;
+
+    /**
+     * Start a pool.
+     * @param threads Number of participating threads including the caller
+     * of parallelFor(); 0 uses the number of hardware threads
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool();
+
+    /**
+     * Run task over [0, count) and wait until every index is processed.
+     * @param count Number of indices
+     * @param task Function called with disjoint, non-empty ranges
+     * @param grain Largest range handed to a single task call
+     */
+    void parallelFor(size_t count, const Task &task, size_t grain = 1);
+
+    /**
+     * Number of participating threads including the caller.
+     */
+    unsigned size() const;
+
+    /**
+     * Process wide pool sized to the hardware.
+     */
+    static ThreadPool & shared();
+
+private:
+    struct Range
+    {
+        std::mutex lock;
+        size_t begin;
+        size_t end;
+    };
+
+    std::vector<std::thread> mThreads;
+    std::unique_ptr<Range[]> mRanges;
+
+    std::mutex mCallMutex;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    const Task *mTask;
+    size_t mGrain;
+    unsigned mGeneration;
+    unsigned mActive;
+    bool mStop;
+
+    void workerLoop(unsigned slot);
+    void runSlot(unsigned slot);
+    bool take(unsigned slot, size_t &begin, size_t &end);
+    bool steal(unsigned slot);
+};
+
+#endif
@@ -0,0 +1,198 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Thumbnail.h"
+#include "BitplaneOps.h"
+#include "PixelDecoder.h"
+
+#include <algorithm>
+
+namespace {
+
+/** Characters for increasing gray levels. */
+const char RAMP[] = " .:-=+*#%@";
+const int RAMP_STEPS = int(sizeof(RAMP)) - 1;
+
+/**
+ * Count the digits of a version 2 column block, 8 rows (64 digits) at a
+ * time. factor must be a multiple of 8 so each 8 rows fall into one cell.
+ * Meant to run inside BitplaneOps::withPopcount().
+ * @param cell Counts of the block's thumbnail column, in the first row
+ * @param width Thumbnail width, the distance between rows of counts
+ */
+inline void addBlockColumn(const char *src, int rows, int factor, uint32_t *cell, int width)
+{
+    for (int y = 0, next = factor; y < rows; y += 8) {
+        if (y == next) {
+            cell += width;
+            next += factor;
+        }
+        *cell += uint32_t(__builtin_popcountll(PixelDecoder::pack64(src + size_t(y) * 8)));
+    }
+}
+
+}
+
+Thumbnail::Thumbnail() :
+    mImageWidth(0), mImageHeight(0), mFactor(1), mWidth(0), mHeight(0), mCounts(),
+    mSegments()
+{
+}
+
+Thumbnail::Thumbnail(int imageWidth, int imageHeight, int factor) :
+    mImageWidth(std::max(imageWidth, 0)), mImageHeight(std::max(imageHeight, 0)),
+    mFactor(std::min(std::max(factor, 1), 65535)), mWidth(0), mHeight(0), mCounts(),
+    mSegments()
+{
+    mWidth = (mImageWidth + mFactor - 1) / mFactor;
+    mHeight = (mImageHeight + mFactor - 1) / mFactor;
+    mCounts.assign(size_t(mWidth) * size_t(mHeight), 0);
+
+    // Split each row word at the thumbnail pixel boundaries.
+    for (int x = 0; x < mImageWidth;) {
+        const int cell = x / mFactor;
+        const int end = std::min(std::min((cell + 1) * mFactor, (x | 63) + 1), mImageWidth);
+        const int bits = end - x;
+        const uint64_t mask = bits == 64 ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1) << (x & 63);
+        mSegments.push_back(Segment{ mask, uint32_t(x >> 6), uint32_t(cell) });
+        x = end;
+    }
+}
+
+Thumbnail Thumbnail::fromBitplane(const Bitplane &pixels, int factor)
+{
+    Thumbnail thumbnail(pixels.width(), pixels.height(), factor);
+    for (int y = 0; y < pixels.height(); ++y) {
+        thumbnail.addRow(y, pixels.row(y));
+    }
+    return thumbnail;
+}
+
+Thumbnail Thumbnail::fromV2(const char *data, size_t length, int width, int height,
+                            int factor)
+{
+    Thumbnail thumbnail(width, height, factor);
+    const size_t blockSize = size_t(8) * size_t(height);
+    const int blocks = (width + 7) / 8;
+    // With factor a multiple of 8, 8 rows of a block always fall into one
+    // thumbnail pixel, so 64 digits take a single popcount.
+    const bool wholeBlocks = thumbnail.mFactor % 8 == 0;
+
+    for (int block = 0; block < blocks; ++block) {
+        const int x = block * 8;
+        const int blockWidth = std::min(8, width - x);
+        const char *src = data + size_t(block) * blockSize;
+        const size_t available = size_t(block) * blockSize < length
+                                 ? length - size_t(block) * blockSize : 0;
+        int y = 0;
+
+        if (blockWidth == 8 && wholeBlocks) {
+            y = int(std::min(size_t(height), available / 8)) & ~7;
+            uint32_t *cell = thumbnail.mCounts.data() + x / thumbnail.mFactor;
+            BitplaneOps::withPopcount([&] {
+                addBlockColumn(src, y, thumbnail.mFactor, cell, thumbnail.mWidth);
+            });
+        } else if (blockWidth == 8) {
+            for (; y + 8 <= height && size_t(y + 8) * 8 <= available; y += 8) {
+                const uint64_t bits = PixelDecoder::pack64(src + size_t(y) * 8);
+                for (int k = 0; k < 8; ++k) {
+                    thumbnail.addBits(x, y + k, (bits >> (8 * k)) & 0xff, 8);
+                }
+            }
+        }
+        for (; y < height; ++y) {
+            const size_t offset = size_t(y) * size_t(blockWidth);
+            if (offset >= available) {
+                break;
+            }
+            const int count = int(std::min(size_t(blockWidth), available - offset));
+            thumbnail.addBits(x, y, PixelDecoder::packScalar(src + offset, count), count);
+        }
+    }
+    return thumbnail;
+}
+
+void Thumbnail::addRow(int y, const uint64_t *row)
+{
+    uint32_t *counts = mCounts.data() + size_t(y / mFactor) * size_t(mWidth);
+    BitplaneOps::withPopcount([&] {
+        for (const Segment &segment : mSegments) {
+            counts[segment.cell] += uint32_t(__builtin_popcountll(row[segment.word] & segment.mask));
+        }
+    });
+}
+
+void Thumbnail::addBits(int x, int y, uint64_t bits, int count)
+{
+    uint32_t *counts = mCounts.data() + size_t(y / mFactor) * size_t(mWidth);
+    while (bits && count > 0) {
+        const int cell = x / mFactor;
+        const int take = std::min(count, (cell + 1) * mFactor - x);
+        const uint64_t mask = take >= 64 ? ~uint64_t(0) : (uint64_t(1) << take) - 1;
+        counts[cell] += uint32_t(__builtin_popcountll(bits & mask));
+        bits = take >= 64 ? 0 : bits >> take;
+        x += take;
+        count -= take;
+    }
+}
+
+int Thumbnail::level(int x, int y) const
+{
+    // Edge blocks are only partly inside the image.
+    const uint64_t w = uint64_t(std::min(mFactor, mImageWidth - x * mFactor));
+    const uint64_t h = uint64_t(std::min(mFactor, mImageHeight - y * mFactor));
+    const uint64_t area = w * h;
+    return int((uint64_t(count(x, y)) * MAX_LEVEL + area / 2) / area);
+}
+
+Bitplane Thumbnail::toBitplane(int threshold) const
+{
+    Bitplane pixels;
+    if (empty() || !pixels.reset(mWidth, mHeight)) {
+        return pixels;
+    }
+    for (int y = 0; y < mHeight; ++y) {
+        uint64_t *row = pixels.row(y);
+        for (int x = 0; x < mWidth; ++x) {
+            if (level(x, y) >= threshold) {
+                row[x >> 6] |= uint64_t(1) << (x & 63);
+            }
+        }
+    }
+    return pixels;
+}
+
+void Thumbnail::renderTo(string &out) const
+{
+    const size_t lineLength = size_t(mWidth) + 1;
+    out.resize(lineLength * size_t(mHeight));
+    char *dst = out.empty() ? 0 : &out[0];
+    for (int y = 0; y < mHeight; ++y) {
+        for (int x = 0; x < mWidth; ++x) {
+            // Rounded up, so a block with any pixel set is not blank.
+            dst[x] = RAMP[(level(x, y) * (RAMP_STEPS - 1) + MAX_LEVEL - 1) / MAX_LEVEL];
+        }
+        dst[mWidth] = '\n';
+        dst += lineLength;
+    }
+}
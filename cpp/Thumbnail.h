@@ -0,0 +1,150 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <string>
+using std::string;
+
+#include "Bitplane.h"
+
+/**
+ * Downscaled preview of an icon.
+ *
+ * Every thumbnail pixel covers a factor x factor block of the image (less
+ * at the right and bottom edges) and holds the number of set pixels in it,
+ * counted with popcounts over packed rows. level() turns the count into a
+ * gray value, toBitplane() into a bitmap again.
+ *
+ * Rows can be added one at a time, so thumbnails are built from lazily
+ * decoded icons or straight from a version 2 payload without decoding the
+ * whole image first.
+ */
+class Thumbnail
+{
+public:
+    /** Largest gray value, for fully covered blocks. */
+    static const int MAX_LEVEL = 255;
+
+    /**
+     * Construct an empty thumbnail.
+     */
+    Thumbnail();
+
+    /**
+     * Construct a thumbnail of an image with no pixels added yet.
+     * @param imageWidth Width of the full image
+     * @param imageHeight Height of the full image
+     * @param factor Downscaling factor, 1 to 65535
+     */
+    Thumbnail(int imageWidth, int imageHeight, int factor);
+
+    /**
+     * Downscale decoded pixels.
+     */
+    static Thumbnail fromBitplane(const Bitplane &pixels, int factor);
+
+    /**
+     * Downscale a version 2 payload (8 pixel wide column blocks) without
+     * decoding it into rows. A short payload counts as cleared pixels.
+     * @param data Start of the data field
+     * @param length Length of the data field in bytes
+     * @param width Image width
+     * @param height Image height
+     * @param factor Downscaling factor
+     */
+    static Thumbnail fromV2(const char *data, size_t length, int width, int height,
+                            int factor);
+
+    /**
+     * Count one image row.
+     * @param y Row of the image
+     * @param row Bitplane::strideFor(imageWidth) words with cleared padding
+     */
+    void addRow(int y, const uint64_t *row);
+
+    /**
+     * Count up to 64 pixels of an image row.
+     * @param x Column of bit 0
+     * @param y Row of the image
+     * @param bits Pixels, LSB first
+     * @param count Number of valid bits
+     */
+    void addBits(int x, int y, uint64_t bits, int count);
+
+    /**
+     * Gray value of a thumbnail pixel, 0 for an empty block up to
+     * MAX_LEVEL for a full one.
+     */
+    int level(int x, int y) const;
+
+    /**
+     * Bitmap thumbnail with the pixels set whose level reaches a threshold.
+     * @param threshold Smallest level of a set pixel, 1 to MAX_LEVEL
+     */
+    Bitplane toBitplane(int threshold = MAX_LEVEL / 2 + 1) const;
+
+    /**
+     * Render the gray values as "ascii art" into a buffer, replacing its
+     * content.
+     * @param out Receives one line per thumbnail row
+     */
+    void renderTo(string &out) const;
+
+    // GETTER
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    int factor() const { return mFactor; }
+    bool empty() const { return mCounts.empty(); }
+
+    /**
+     * Number of set pixels in the block of a thumbnail pixel.
+     */
+    uint32_t count(int x, int y) const { return mCounts[size_t(y) * size_t(mWidth) + size_t(x)]; }
+
+private:
+    /**
+     * Part of an image row word that falls into one thumbnail pixel.
+     */
+    struct Segment
+    {
+        uint64_t mask;
+        uint32_t word;
+        uint32_t cell;
+    };
+
+    int mImageWidth;
+    int mImageHeight;
+    int mFactor;
+    int mWidth;
+    int mHeight;
+    std::vector<uint32_t> mCounts;
+    std::vector<Segment> mSegments;    ///< of one image row, for addRow
+};
+
+#endif
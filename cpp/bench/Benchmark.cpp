@@ -0,0 +1,536 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Micro and macro benchmarks for the SimpleIcon pipeline.
+ *
+ * Every case runs repeatedly until it has taken at least --min-time
+ * seconds, then reports time per iteration, throughput in pixels/s and
+ * MB/s and the peak resident set size of the process so far. Results are
+ * printed as a table and can be written as JSON for regression tracking.
+ */
+
+#include "BitplaneAnalysis.h"
+#include "BitplaneOps.h"
+#include "IconArena.h"
+#include "IconAtlas.h"
+#include "IconGenerator.h"
+#include "PixelDecoder.h"
+#include "PixelEncoder.h"
+#include "SharedIconStore.h"
+#include "SimpleIcon.h"
+#include "SimpleIconCache.h"
+#include "Thumbnail.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <vector>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace {
+
+struct Options
+{
+    double minTime = 0.2;
+    string filter;
+    string json;
+    std::vector<std::pair<int, int>> sizes = { {64, 64}, {1024, 1024}, {4096, 4096} };
+    std::vector<double> densities = { 0.5, 0.05 };
+};
+
+struct Result
+{
+    string name;
+    size_t iterations;
+    double nsPerIteration;
+    double pixelsPerSecond;
+    double bytesPerSecond;
+    long peakRssKb;
+};
+
+/** Keeps results alive so the optimizer cannot drop benchmarked work. */
+volatile uint64_t sSink = 0;
+
+long peakRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+class Runner
+{
+public:
+    explicit Runner(const Options &options) :
+        mOptions(options)
+    {
+    }
+
+    /**
+     * Run one case.
+     * @param name Case name, matched against --filter
+     * @param pixels Pixels processed per iteration
+     * @param bytes Bytes processed per iteration
+     * @param body Work of one iteration
+     */
+    void run(const string &name, size_t pixels, size_t bytes,
+             const std::function<void()> &body)
+    {
+        if (!mOptions.filter.empty() && name.find(mOptions.filter) == string::npos) {
+            return;
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        body();
+
+        size_t iterations = 0;
+        size_t batch = 1;
+        double elapsed = 0;
+        while (elapsed < mOptions.minTime) {
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < batch; ++i) {
+                body();
+            }
+            elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+            iterations += batch;
+            batch *= 2;
+        }
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        result.nsPerIteration = elapsed * 1e9 / double(iterations);
+        result.pixelsPerSecond = double(pixels) * double(iterations) / elapsed;
+        result.bytesPerSecond = double(bytes) * double(iterations) / elapsed;
+        result.peakRssKb = peakRssKb();
+        mResults.push_back(result);
+
+        std::printf("%-44s %12.0f ns %10.1f Mpx/s %10.1f MB/s %8ld KiB\n",
+                    name.c_str(), result.nsPerIteration,
+                    result.pixelsPerSecond / 1e6, result.bytesPerSecond / 1e6,
+                    result.peakRssKb);
+        std::fflush(stdout);
+    }
+
+    bool writeJson(const string &file) const
+    {
+        std::ofstream out(file);
+        out << "{\n  \"context\": {\n" <<
+               "    \"isa\": \"" << PixelDecoder::isaName(PixelDecoder::isa()) << "\",\n" <<
+               "    \"min_time\": " << mOptions.minTime << "\n  },\n" <<
+               "  \"benchmarks\": [\n";
+        for (size_t i = 0; i < mResults.size(); ++i) {
+            const Result &r = mResults[i];
+            out << "    {\"name\": \"" << r.name << "\", " <<
+                   "\"iterations\": " << r.iterations << ", " <<
+                   "\"real_time\": " << r.nsPerIteration << ", " <<
+                   "\"time_unit\": \"ns\", " <<
+                   "\"items_per_second\": " << r.pixelsPerSecond << ", " <<
+                   "\"bytes_per_second\": " << r.bytesPerSecond << ", " <<
+                   "\"peak_rss_kb\": " << r.peakRssKb << "}" <<
+                   (i + 1 < mResults.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+        return bool(out);
+    }
+
+private:
+    const Options &mOptions;
+    std::vector<Result> mResults;
+};
+
+string temporaryFile(const string &content)
+{
+    char path[] = "/tmp/simpleicon-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return string();
+    }
+    size_t done = 0;
+    while (done < content.size()) {
+        ssize_t written = write(fd, content.data() + done, content.size() - done);
+        if (written <= 0) {
+            break;
+        }
+        done += size_t(written);
+    }
+    close(fd);
+    return path;
+}
+
+/**
+ * Header parsing as done before parseHeaderFields: token vector plus one
+ * stringstream per number.
+ */
+size_t parseHeaderWithStreams(string_view header, int &fileVersion, int &width, int &height)
+{
+    std::vector<string> tokens;
+    size_t start = 0;
+    for (int i = 0; i < 3; ++i) {
+        size_t pos = header.find(SimpleIcon::DELIM, start);
+        tokens.push_back(string(header.substr(start, pos - start)));
+        start = pos + SimpleIcon::DELIM.size();
+    }
+
+    std::stringstream version(tokens[1]);
+    version >> fileVersion;
+    const size_t x = tokens[2].find('x');
+    std::stringstream size(tokens[2].substr(0, x));
+    size >> width;
+    size.clear();
+    size.str(tokens[2].substr(x + 1));
+    size >> height;
+    return tokens[0].size();
+}
+
+void benchmarkIcon(Runner &runner, int width, int height, double density)
+{
+    IconGenerator generator(width, height, density);
+    const size_t pixels = size_t(width) * size_t(height);
+    char suffix[64];
+    std::snprintf(suffix, sizeof(suffix), "/%dx%d/d%.2f", width, height, density);
+
+    for (int version = 1; version <= 2; ++version) {
+        const string text = generator.text(version);
+        const string payload = generator.payload(version);
+        const string v = "/v" + std::to_string(version);
+
+        const string file = temporaryFile(text);
+        runner.run("loadFromFile" + v + suffix, pixels, text.size(), [&] {
+            SimpleIcon icon;
+            icon.loadFromFile(file);
+            sSink += icon.pixels().words()[0];
+        });
+
+        SimpleIconCache cache;
+        runner.run("cacheHit" + v + suffix, pixels, text.size(), [&] {
+            sSink += cache.get(file)->pixels().words()[0];
+        });
+        std::remove(file.c_str());
+
+        runner.run("loadFromMemory" + v + suffix, pixels, text.size(), [&] {
+            SimpleIcon icon;
+            icon.loadFromMemory(text);
+            sSink += icon.pixels().words()[0];
+        });
+
+        // Header plus a single row, as for hit testing.
+        std::vector<uint64_t> row(size_t(Bitplane::strideFor(width)));
+        runner.run("loadLazyRow" + v + suffix, width, text.size(), [&] {
+            SimpleIcon icon;
+            icon.loadFromMemory(text, SimpleIcon::LAZY);
+            icon.readRow(height / 2, row.data());
+            sSink += row[0];
+        });
+
+        // Many icons alive at once as in a batch load, on the heap and in
+        // one arena. Small icons are loaded in larger groups.
+        const size_t count = std::min<size_t>(256, std::max<size_t>(1, (size_t(1) << 20) / pixels));
+        runner.run("loadBatch/heap" + v + suffix, pixels * count, text.size() * count, [&] {
+            std::vector<SimpleIcon> icons(count);
+            for (SimpleIcon &icon : icons) {
+                icon.loadFromMemory(text);
+            }
+            sSink += icons.back().pixels().words()[0];
+        });
+
+        IconArena arena;
+        runner.run("loadBatch/arena" + v + suffix, pixels * count, text.size() * count, [&] {
+            {
+                std::vector<SimpleIcon> icons;
+                icons.reserve(count);
+                for (size_t i = 0; i < count; ++i) {
+                    icons.emplace_back(arena);
+                    icons.back().loadFromMemory(text);
+                }
+                sSink += icons.back().pixels().words()[0];
+            }
+            arena.reset();
+        });
+
+        // Header part of parseHeader, and the former stringstream based
+        // parsing as a reference.
+        const string_view header(text.data(), text.size() - payload.size());
+        runner.run("parseHeader" + v + suffix, 1, header.size(), [&] {
+            SimpleIcon::Header fields;
+            SimpleIcon::parseHeaderFields(text, fields);
+            sSink += fields.fileVersion + fields.width + fields.height + fields.name.size();
+        });
+        runner.run("parseHeader/stringstream" + v + suffix, 1, header.size(), [&] {
+            int fileVersion, w, h;
+            sSink += parseHeaderWithStreams(header, fileVersion, w, h);
+            sSink += fileVersion + w + h;
+        });
+
+        Bitplane target(width, height);
+        runner.run(string(version == 1 ? "parseData" : "parseDataV2") + suffix,
+                   pixels, payload.size(), [&] {
+            std::memset(target.words(), 0, target.sizeInBytes());
+            if (version == 1) {
+                PixelDecoder::decodeV1(payload.data(), payload.size(), target);
+            } else {
+                PixelDecoder::decodeV2(payload.data(), payload.size(), target);
+            }
+            sSink += target.words()[0];
+        });
+
+        // The inverse: payload straight from the bitplane, and the whole
+        // file content including the header.
+        string encoded(payload.size(), '\0');
+        runner.run(string(version == 1 ? "encodeData" : "encodeDataV2") + suffix,
+                   pixels, payload.size(), [&] {
+            if (version == 1) {
+                PixelEncoder::encodeV1(generator.pixels(), &encoded[0]);
+            } else {
+                PixelEncoder::encodeV2(generator.pixels(), &encoded[0]);
+            }
+            sSink += uint64_t(encoded[encoded.size() / 2]);
+        });
+
+        const SimpleIcon source("Generated", 1, generator.pixels());
+        string content;
+        runner.run("encode" + v + suffix, pixels, text.size(), [&] {
+            source.encode(version, content);
+            sSink += content.size();
+        });
+
+        if (version == 2) {
+            runner.run(string("thumbnail/v2payload/f8") + suffix, pixels, payload.size(), [&] {
+                sSink += Thumbnail::fromV2(payload.data(), payload.size(), width, height, 8).count(0, 0);
+            });
+        }
+    }
+
+    SimpleIcon icon("Generated", 1, generator.pixels());
+    string frame;
+    icon.renderTo(frame);
+    runner.run(string("renderTo") + suffix, pixels, frame.size(), [&] {
+        icon.renderTo(frame);
+        sSink += uint64_t(frame[frame.size() / 2]);
+    });
+
+    // Word aligned and funnel shifted source rows.
+    const Bitplane &source = generator.pixels();
+    Bitplane combined(source);
+    for (int x : {0, 3}) {
+        runner.run("combine/xor/x" + std::to_string(x) + suffix, pixels,
+                   source.sizeInBytes(), [&] {
+            BitplaneOps::combine(combined, source, BitplaneOps::XOR, x, 0);
+            sSink += combined.row(0)[0];
+        });
+    }
+    runner.run(string("rotate90") + suffix, pixels, source.sizeInBytes(), [&] {
+        sSink += BitplaneOps::rotate90(source).words()[0];
+    });
+
+    runner.run(string("countPixels") + suffix, pixels, source.sizeInBytes(), [&] {
+        sSink += BitplaneAnalysis::countPixels(source);
+    });
+    runner.run(string("boundingBox") + suffix, pixels, source.sizeInBytes(), [&] {
+        sSink += uint64_t(BitplaneAnalysis::boundingBox(source).width);
+    });
+    for (int factor : {3, 8}) {
+        runner.run("thumbnail/f" + std::to_string(factor) + suffix, pixels,
+                   source.sizeInBytes(), [&] {
+            sSink += Thumbnail::fromBitplane(source, factor).count(0, 0);
+        });
+    }
+    std::vector<BitplaneAnalysis::Component> components;
+    runner.run(string("labelComponents") + suffix, pixels, source.sizeInBytes(), [&] {
+        sSink += uint64_t(BitplaneAnalysis::labelComponents(source, components));
+    });
+
+    FILE *devNull = std::fopen("/dev/null", "w");
+    if (devNull) {
+        runner.run(string("display") + suffix, pixels, frame.size(), [&] {
+            icon.renderTo(devNull);
+        });
+        std::fclose(devNull);
+    }
+}
+
+/**
+ * Many small icons, a quarter of them duplicates, from separate files and
+ * from one atlas.
+ */
+void benchmarkAtlas(Runner &runner)
+{
+    const int count = 256;
+    const int size = 32;
+    std::vector<string> files;
+    std::vector<string> names;
+    IconAtlas atlas;
+    const string storeName = "/SimpleIconBench." + std::to_string(::getpid());
+    SharedIconStore store(storeName);
+    size_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        const IconGenerator generator(size, size, 0.3, unsigned(i % (count * 3 / 4) + 1));
+        const string text = "icon" + std::to_string(i) + generator.text(1).substr(generator.text(1).find(";;"));
+        files.push_back(temporaryFile(text));
+        bytes += text.size();
+        SimpleIcon icon;
+        icon.loadFromMemory(text);
+        atlas.add(icon);
+        store.add(icon);
+        names.push_back(string(icon.name()));
+    }
+    atlas.build();
+    const string atlasFile = temporaryFile(string());
+    atlas.save(atlasFile);
+
+    const size_t pixels = size_t(count) * size * size;
+    runner.run("loadFiles/256x32x32", pixels, bytes, [&] {
+        for (const string &file : files) {
+            SimpleIcon icon;
+            icon.loadFromFile(file);
+            sSink += icon.pixels().words()[0];
+        }
+    });
+    runner.run("atlasLoad/256x32x32", pixels, bytes, [&] {
+        IconAtlas loaded;
+        loaded.load(atlasFile);
+        for (const string &name : names) {
+            SimpleIcon icon;
+            loaded.icon(name, icon);
+            sSink += icon.pixels().words()[0];
+        }
+    });
+    runner.run("atlasFind/256x32x32", count, 0, [&] {
+        IconAtlas::Entry entry;
+        for (const string &name : names) {
+            sSink += atlas.find(name, entry) ? uint64_t(entry.rect.x) : 0;
+        }
+    });
+
+    // Attaching a published generation, and icons viewing its pixels.
+    store.publish();
+    runner.run("sharedAttach/256x32x32", pixels, bytes, [&] {
+        SharedIconStore attached(storeName);
+        attached.attach();
+        for (const string &name : names) {
+            SimpleIcon icon;
+            attached.current()->find(name, icon);
+            sSink += icon.pixels().words()[0];
+        }
+    });
+    SharedIconStore attached(storeName);
+    attached.attach();
+    std::shared_ptr<const SharedIconStore::Generation> generation = attached.current();
+    runner.run("sharedFind/256x32x32", count, 0, [&] {
+        for (const string &name : names) {
+            SimpleIcon icon;
+            sSink += generation->find(name, icon) ? icon.pixels().words()[0] : 0;
+        }
+    });
+    store.unlink();
+
+    for (const string &file : files) {
+        std::remove(file.c_str());
+    }
+    std::remove(atlasFile.c_str());
+}
+
+bool parseSizes(const string &text, Options &options)
+{
+    options.sizes.clear();
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        if (end == string::npos) {
+            end = text.size();
+        }
+        int width, height;
+        if (std::sscanf(text.substr(start, end - start).c_str(), "%dx%d", &width, &height) != 2
+                || width <= 0 || height <= 0) {
+            return false;
+        }
+        options.sizes.push_back(std::make_pair(width, height));
+        start = end + 1;
+    }
+    return !options.sizes.empty();
+}
+
+void usage()
+{
+    std::cerr << "Usage: SimpleIconBench [--min-time seconds] [--filter text]\n"
+                 "                       [--sizes WxH,...] [--density d]\n"
+                 "                       [--isa scalar|sse2|avx2] [--json file]" << endl;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--min-time") {
+            options.minTime = std::atof(value.c_str());
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--json") {
+            options.json = value;
+        } else if (arg == "--density") {
+            options.densities = { std::atof(value.c_str()) };
+        } else if (arg == "--isa") {
+            PixelDecoder::setIsa(value == "scalar" ? PixelDecoder::SCALAR
+                                 : value == "sse2" ? PixelDecoder::SSE2
+                                 : PixelDecoder::AVX2);
+        } else if (arg != "--sizes" || !parseSizes(value, options)) {
+            usage();
+            return 1;
+        }
+    }
+
+    cout << "isa: " << PixelDecoder::isaName(PixelDecoder::isa()) << endl;
+    Runner runner(options);
+    for (const std::pair<int, int> &size : options.sizes) {
+        for (double density : options.densities) {
+            benchmarkIcon(runner, size.first, size.second, density);
+        }
+    }
+    benchmarkAtlas(runner);
+
+    if (!options.json.empty() && !runner.writeJson(options.json)) {
+        std::cerr << "Unable to write '" << options.json << "'" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IconGenerator.h"
+
+#include <random>
+
+IconGenerator::IconGenerator(int width, int height, double density, unsigned seed) :
+    mPixels(width, height)
+{
+    std::mt19937_64 random(seed);
+    const uint64_t threshold = uint64_t(density * 18446744073709551615.0);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (density >= 1.0 || random() < threshold) {
+                mPixels.set(x, y, true);
+            }
+        }
+    }
+}
+
+string IconGenerator::text(int version) const
+{
+    return "Generated;;" + std::to_string(version) + ";;" +
+           std::to_string(width()) + "x" + std::to_string(height()) + ";;" +
+           payload(version);
+}
+
+string IconGenerator::payload(int version) const
+{
+    string data;
+    data.reserve(size_t(width()) * size_t(height()));
+
+    if (version == 1) {
+        for (int y = 0; y < height(); ++y) {
+            for (int x = 0; x < width(); ++x) {
+                data += mPixels.get(x, y) ? '1' : '0';
+            }
+        }
+        return data;
+    }
+
+    for (int offset = 0; offset < width(); offset += 8) {
+        for (int y = 0; y < height(); ++y) {
+            for (int x = offset; x < offset + 8 && x < width(); ++x) {
+                data += mPixels.get(x, y) ? '1' : '0';
+            }
+        }
+    }
+    return data;
+}
+
+// GETTER
+
+const Bitplane & IconGenerator::pixels() const
+{
+    return mPixels;
+}
+
+int IconGenerator::width() const
+{
+    return mPixels.width();
+}
+
+int IconGenerator::height() const
+{
+    return mPixels.height();
+}
@@ -0,0 +1,69 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ICONGENERATOR_H
+#define ICONGENERATOR_H
+
+#include <string>
+using std::string;
+
+#include "Bitplane.h"
+
+/**
+ * Generates synthetic icons for benchmarks.
+ *
+ * Pixels are set at random with the given density. The same parameters
+ * and seed always produce the same icon.
+ */
+class IconGenerator
+{
+public:
+    /**
+     * Generate an icon.
+     * @param width Image width
+     * @param height Image height
+     * @param density Fraction of set pixels, 0.0 to 1.0
+     * @param seed Random seed
+     */
+    IconGenerator(int width, int height, double density, unsigned seed = 1);
+
+    /**
+     * Complete text file content in the given version (1 or 2).
+     */
+    string text(int version) const;
+
+    /**
+     * Only the data field of text(), without the header.
+     */
+    string payload(int version) const;
+
+    // GETTER
+    const Bitplane & pixels() const;
+    int width() const;
+    int height() const;
+
+private:
+    Bitplane mPixels;
+};
+
+#endif
@@ -57,14 +57,404 @@
  * 12345678 12345678 1234 1234
  */
 
+#include "IconAtlas.h"
+#include "IconIndex.h"
+#include "SharedIconStore.h"
 #include "SimpleIcon.h"
+#include "SimpleIconBatch.h"
+#include "SimpleIconStats.h"
+#include "SimpleIconStreamParser.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
 
 #include <iostream>
+using std::cerr;
 using std::cout;
 using std::endl;
 
-int main()
+/**
+ * Parse an image piece by piece from standard input, e.g. from a pipe.
+ */
+static int displayFromStdin()
+{
+    SimpleIconStreamParser parser;
+    char chunk[65536];
+    ssize_t count;
+
+    while ((count = read(STDIN_FILENO, chunk, sizeof(chunk))) > 0) {
+        if (parser.feed(chunk, size_t(count)) != SimpleIcon::Error::NO_ERROR) {
+            return 1;
+        }
+    }
+    if (count < 0 || parser.finish() != SimpleIcon::Error::NO_ERROR) {
+        return 1;
+    }
+
+    parser.takeIcon().display();
+    return 0;
+}
+
+/**
+ * Add the files and directories argv[first] ... argv[argc - 1] to a batch.
+ * @return false if a directory could not be read
+ */
+static bool collectInputs(int argc, char *argv[], int first, SimpleIconBatch &batch)
 {
-    SimpleIcon sv1("data/schwert2.txt");
+    for (int i = first; i < argc; ++i) {
+        struct stat st;
+        if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            if (!batch.addDirectory(argv[i])) {
+                std::cerr << "Unable to read directory '" << argv[i] << "'" << endl;
+                return false;
+            }
+        } else {
+            batch.addFile(argv[i]);
+        }
+    }
+    return true;
+}
+
+/**
+ * Load all given files and directories in parallel and list the results.
+ * Arguments: [-j threads] <file|directory>...
+ */
+static int loadBatch(int argc, char *argv[])
+{
+    unsigned threads = 0;
+    int first = 0;
+    if (argc >= 2 && string(argv[0]) == "-j") {
+        threads = unsigned(std::atoi(argv[1]));
+        first = 2;
+    }
+
+    SimpleIconBatch batch;
+    if (!collectInputs(argc, argv, first, batch)) {
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    IconArena arena;
+    int failed = 0;
+    for (const SimpleIconBatch::Result &result : batch.load(arena, pool)) {
+        cout << result.file << ": ";
+        if (result.error != SimpleIcon::Error::NO_ERROR) {
+            cout << "error " << result.error << endl;
+            ++failed;
+            continue;
+        }
+        cout << result.icon.name() << "(" << result.icon.width() << "x" <<
+                result.icon.height() << ") Version: " <<
+                result.icon.fileVersion() << endl;
+    }
+
+    return failed ? 1 : 0;
+}
+
+/**
+ * Create or update an index of the given files and directories.
+ * Arguments: <index> <file|directory>...
+ */
+static int buildIndex(int argc, char *argv[])
+{
+    if (argc < 1) {
+        std::cerr << "Usage: SimpleIcon --index <index> <file|directory>..." << endl;
+        return 1;
+    }
+
+    IconIndex index;
+    struct stat st;
+    if (stat(argv[0], &st) == 0 && !index.load(argv[0])) {
+        return 1;
+    }
+    index.prune();
+
+    SimpleIconBatch batch;
+    if (!collectInputs(argc, argv, 1, batch)) {
+        return 1;
+    }
+    for (const string &file : batch.files()) {
+        index.addFile(file);
+    }
+
+    if (!index.save(argv[0])) {
+        return 1;
+    }
+    cout << index.size() << " icons indexed" << endl;
+    return 0;
+}
+
+/**
+ * List the icons of an index matching all given criteria.
+ * Arguments: <index> [WxH] [vVERSION] [name pattern]
+ */
+static int queryIndex(int argc, char *argv[])
+{
+    IconIndex index;
+    if (argc < 1 || !index.load(argv[0])) {
+        return 1;
+    }
+
+    IconIndex::Query query;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (!arg.empty() && std::isdigit(static_cast<unsigned char>(arg[0]))) {
+            if (SimpleIcon::parseSize(arg, query.width, query.height) !=
+                SimpleIcon::Error::NO_ERROR) {
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == 'v' &&
+                   std::isdigit(static_cast<unsigned char>(arg[1]))) {
+            if (SimpleIcon::parseVersion(string_view(arg).substr(1), query.fileVersion) !=
+                SimpleIcon::Error::NO_ERROR) {
+                return 1;
+            }
+        } else {
+            query.name = arg;
+        }
+    }
+
+    for (const IconIndex::Entry *entry : index.find(query)) {
+        cout << entry->file() << ": " << entry->name() << "(" << entry->width() <<
+                "x" << entry->height() << ") Version: " << entry->fileVersion() << endl;
+    }
+    return 0;
+}
+
+/**
+ * Pack the given files and directories into an atlas, storing identical
+ * icons once. Icons are found by name, or by file if the name is taken.
+ * Arguments: <atlas> <file|directory>...
+ */
+static int buildAtlas(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: SimpleIcon --atlas <atlas> <file|directory>..." << endl;
+        return 1;
+    }
+
+    SimpleIconBatch batch;
+    if (!collectInputs(argc, argv, 1, batch)) {
+        return 1;
+    }
+
+    IconAtlas atlas;
+    for (const SimpleIconBatch::Result &result : batch.load()) {
+        if (result.error != SimpleIcon::Error::NO_ERROR) {
+            std::cerr << result.file << ": error " << result.error << endl;
+        } else if (!atlas.add(result.icon) && !atlas.add(result.icon, result.file)) {
+            std::cerr << result.file << ": added twice" << endl;
+        }
+    }
+    if (!atlas.build() || !atlas.save(argv[0])) {
+        return 1;
+    }
+    cout << atlas.size() << " icons, " << atlas.uniqueImages() << " unique, atlas " <<
+            atlas.pixels().width() << "x" << atlas.pixels().height() << endl;
+    return 0;
+}
+
+/**
+ * Display one icon of an atlas.
+ */
+static int displayFromAtlas(const string &file, const string &name)
+{
+    IconAtlas atlas;
+    SimpleIcon icon;
+    if (!atlas.load(file)) {
+        return 1;
+    }
+    if (!atlas.icon(name, icon)) {
+        std::cerr << "No icon '" << name << "' in '" << file << "'" << endl;
+        return 1;
+    }
+    icon.display();
+    return 0;
+}
+
+/**
+ * Load the given files and directories and publish them as the next
+ * generation of a shared memory icon store. Icons are found by name, or
+ * by file if the name is taken.
+ * Arguments: <store> <file|directory>...
+ */
+static int publishShared(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::cerr << "Usage: SimpleIcon --shm-publish </store> <file|directory>..." << endl;
+        return 1;
+    }
+
+    SimpleIconBatch batch;
+    if (!collectInputs(argc, argv, 1, batch)) {
+        return 1;
+    }
+
+    SharedIconStore store(argv[0]);
+    for (const SimpleIconBatch::Result &result : batch.load()) {
+        if (result.error != SimpleIcon::Error::NO_ERROR) {
+            std::cerr << result.file << ": error " << result.error << endl;
+        } else if (!store.add(result.icon) && !store.add(result.icon, result.file)) {
+            std::cerr << result.file << ": added twice" << endl;
+        }
+    }
+    const size_t icons = store.staged();
+    const uint64_t generation = store.publish();
+    if (generation == 0) {
+        return 1;
+    }
+    cout << icons << " icons published as generation " << generation << endl;
+    return 0;
+}
+
+/**
+ * Display one icon of a shared memory icon store.
+ */
+static int displayFromShared(const string &name, const string &icon)
+{
+    SharedIconStore store(name);
+    if (!store.attach()) {
+        return 1;
+    }
+    SimpleIcon found;
+    if (!store.current()->find(icon, found)) {
+        std::cerr << "No icon '" << icon << "' in '" << name << "'" << endl;
+        return 1;
+    }
+    found.display();
+    return 0;
+}
+
+/**
+ * Convert an image datafile (text or binary) into the binary format, or
+ * into a text datafile of the given version.
+ */
+static int convertFile(const string &in, const string &out, int fileVersion = 0)
+{
+    SimpleIcon icon;
+    if (!icon.loadFromFile(in)) {
+        return 1;
+    }
+    bool saved = fileVersion == 0 ? icon.saveBinary(out) : icon.saveToFile(out, fileVersion);
+    return saved ? 0 : 1;
+}
+
+/**
+ * Parse a scaling factor given on the command line.
+ * @return false unless the whole text is a number of at least 1
+ */
+static bool parseFactor(const char *text, int &factor)
+{
+    const char *end = text + std::strlen(text);
+    std::from_chars_result result = std::from_chars(text, end, factor);
+    return result.ec == std::errc() && result.ptr == end && factor >= 1;
+}
+
+/**
+ * Display a box filtered thumbnail of an image, decoding it lazily.
+ */
+static int displayThumbnail(int factor, const string &file)
+{
+    SimpleIcon icon;
+    if (factor <= 0 || !icon.loadFromFile(file, SimpleIcon::LAZY)) {
+        return 1;
+    }
+    string frame;
+    icon.thumbnail(factor).renderTo(frame);
+    cout << icon.name() << " 1:" << factor << endl << frame;
+    return 0;
+}
+
+static int run(int argc, char *argv[])
+{
+    string file = (argc > 1) ? argv[1] : "data/schwert2.txt";
+    if (file == "-") {
+        return displayFromStdin();
+    }
+    if (file == "--batch") {
+        return loadBatch(argc - 2, argv + 2);
+    }
+    if (file == "--index") {
+        return buildIndex(argc - 2, argv + 2);
+    }
+    if (file == "--query") {
+        return queryIndex(argc - 2, argv + 2);
+    }
+    if (file == "--convert" && argc == 4) {
+        return convertFile(argv[2], argv[3]);
+    }
+    if (file == "--convert" && argc == 5) {
+        int fileVersion = std::atoi(argv[4]);
+        return fileVersion > 0 ? convertFile(argv[2], argv[3], fileVersion) : 1;
+    }
+    if (file == "--atlas") {
+        return buildAtlas(argc - 2, argv + 2);
+    }
+    if (file == "--from-atlas" && argc == 4) {
+        return displayFromAtlas(argv[2], argv[3]);
+    }
+    if (file == "--shm-publish") {
+        return publishShared(argc - 2, argv + 2);
+    }
+    if (file == "--shm-show" && argc == 4) {
+        return displayFromShared(argv[2], argv[3]);
+    }
+    if (file == "--shm-remove" && argc == 3) {
+        return SharedIconStore(argv[2]).unlink() ? 0 : 1;
+    }
+    if (file == "--thumbnail" && argc == 4) {
+        return displayThumbnail(std::atoi(argv[2]), argv[3]);
+    }
+    if (file == "--scale") {
+        int scale;
+        if (argc != 4 || !parseFactor(argv[2], scale)) {
+            std::cerr << "Usage: SimpleIcon --scale <factor> <file>" << endl;
+            return 1;
+        }
+        SimpleIcon icon(argv[3]);
+        return icon.renderTo(stdout, scale) ? 0 : 1;
+    }
+
+    SimpleIcon sv1(file);
     sv1.display();
+    return 0;
+}
+
+/**
+ * Remove the --stats flag from the arguments.
+ * @return Whether the flag was given.
+ */
+static bool takeStatsFlag(int &argc, char *argv[])
+{
+    bool found = false;
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--stats") {
+            found = true;
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    return found;
+}
+
+int main(int argc, char *argv[])
+{
+    const bool stats = takeStatsFlag(argc, argv);
+    int result = run(argc, argv);
+
+    if (stats) {
+        if (SimpleIconStats::enabled()) {
+            SimpleIconStats::print(cerr, SimpleIconStats::snapshot());
+        } else {
+            cerr << "Statistics not compiled in, rebuild with: make build STATS=1" << endl;
+        }
+    }
+    return result;
 }
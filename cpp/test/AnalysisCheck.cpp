@@ -0,0 +1,231 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * BitplaneAnalysis against a naive reference: pixel counts for every
+ * instruction set, bounding boxes and connected components found by a
+ * flood fill one pixel at a time.
+ */
+
+#include "Check.h"
+#include "BitplaneAnalysis.h"
+#include "PixelDecoder.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+Bitplane randomImage(int width, int height, double density, std::mt19937 &random)
+{
+    Bitplane pixels(width, height);
+    std::bernoulli_distribution pixel(density);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            pixels.set(x, y, pixel(random));
+        }
+    }
+    return pixels;
+}
+
+/**
+ * Flood fill labeling in scan order.
+ * @param labels Receives a component index per pixel, -1 for clear pixels
+ */
+std::vector<BitplaneAnalysis::Component> labelReference(const Bitplane &pixels,
+                                                        BitplaneAnalysis::Connectivity connectivity,
+                                                        std::vector<int> &labels)
+{
+    const int w = pixels.width();
+    const int h = pixels.height();
+    std::vector<BitplaneAnalysis::Component> components;
+    labels.assign(size_t(w) * size_t(h), -1);
+
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            if (!pixels.get(x, y) || labels[size_t(y) * size_t(w) + size_t(x)] >= 0) {
+                continue;
+            }
+            const int label = int(components.size());
+            int left = x, top = y, right = x, bottom = y;
+            uint64_t count = 0;
+            std::vector<std::pair<int, int>> stack(1, std::make_pair(x, y));
+            labels[size_t(y) * size_t(w) + size_t(x)] = label;
+            while (!stack.empty()) {
+                const int px = stack.back().first;
+                const int py = stack.back().second;
+                stack.pop_back();
+                ++count;
+                left = std::min(left, px);
+                right = std::max(right, px);
+                top = std::min(top, py);
+                bottom = std::max(bottom, py);
+                for (int dy = -1; dy <= 1; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const int nx = px + dx;
+                        const int ny = py + dy;
+                        if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= w || ny >= h ||
+                            (connectivity == BitplaneAnalysis::FOUR && dx != 0 && dy != 0)) {
+                            continue;
+                        }
+                        int &neighbour = labels[size_t(ny) * size_t(w) + size_t(nx)];
+                        if (pixels.get(nx, ny) && neighbour < 0) {
+                            neighbour = label;
+                            stack.push_back(std::make_pair(nx, ny));
+                        }
+                    }
+                }
+            }
+            BitplaneAnalysis::Component component;
+            component.bounds = { left, top, right - left + 1, bottom - top + 1 };
+            component.pixels = count;
+            components.push_back(component);
+        }
+    }
+    return components;
+}
+
+bool sameRect(const BitplaneAnalysis::Rect &a, const BitplaneAnalysis::Rect &b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+string describe(const Bitplane &pixels, const char *what)
+{
+    return string(what) + " " + std::to_string(pixels.width()) + "x" +
+           std::to_string(pixels.height());
+}
+
+void checkCounts(PixelDecoder::Isa isa, const Bitplane &pixels)
+{
+    const string context = string(PixelDecoder::isaName(isa)) + " " + describe(pixels, "count");
+    std::vector<int> rows;
+    BitplaneAnalysis::countRows(pixels, rows);
+    CHECK(rows.size() == size_t(pixels.height()), context);
+
+    uint64_t total = 0;
+    for (int y = 0; y < pixels.height(); ++y) {
+        int row = 0;
+        for (int x = 0; x < pixels.width(); ++x) {
+            row += pixels.get(x, y) ? 1 : 0;
+        }
+        CHECK(BitplaneAnalysis::countRow(pixels, y) == row, context + " row " + std::to_string(y));
+        CHECK(size_t(y) < rows.size() && rows[size_t(y)] == row,
+              context + " rows " + std::to_string(y));
+        total += uint64_t(row);
+    }
+    CHECK(BitplaneAnalysis::countPixels(pixels) == total, context);
+}
+
+void checkBoundingBox(const Bitplane &pixels)
+{
+    int left = pixels.width(), top = pixels.height(), right = -1, bottom = -1;
+    for (int y = 0; y < pixels.height(); ++y) {
+        for (int x = 0; x < pixels.width(); ++x) {
+            if (pixels.get(x, y)) {
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+            }
+        }
+    }
+    const BitplaneAnalysis::Rect box = BitplaneAnalysis::boundingBox(pixels);
+    if (right < 0) {
+        CHECK(box.empty(), describe(pixels, "empty bounding box"));
+    } else {
+        const BitplaneAnalysis::Rect expected = { left, top, right - left + 1, bottom - top + 1 };
+        CHECK(sameRect(box, expected), describe(pixels, "bounding box"));
+    }
+}
+
+void checkComponents(const Bitplane &pixels, BitplaneAnalysis::Connectivity connectivity)
+{
+    const string context = describe(pixels, "components") + " " +
+                           std::to_string(int(connectivity)) + "-connected";
+    std::vector<int> labels;
+    const std::vector<BitplaneAnalysis::Component> expected =
+        labelReference(pixels, connectivity, labels);
+
+    std::vector<BitplaneAnalysis::Component> components;
+    std::vector<BitplaneAnalysis::Run> runs;
+    const int count = BitplaneAnalysis::labelComponents(pixels, components, connectivity, &runs);
+    if (!CHECK(count == int(expected.size()) && components.size() == expected.size(), context)) {
+        return;
+    }
+    for (size_t i = 0; i < expected.size(); ++i) {
+        CHECK(sameRect(components[i].bounds, expected[i].bounds) &&
+              components[i].pixels == expected[i].pixels,
+              context + " component " + std::to_string(i));
+    }
+
+    // The runs cover every set pixel once, with the pixel's component.
+    std::vector<int> covered(labels.size(), -1);
+    bool ordered = true;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const BitplaneAnalysis::Run &run = runs[i];
+        ordered = ordered && (i == 0 || runs[i - 1].y < run.y ||
+                              (runs[i - 1].y == run.y && runs[i - 1].end < run.begin));
+        for (int x = run.begin; x < run.end; ++x) {
+            covered[size_t(run.y) * size_t(pixels.width()) + size_t(x)] = run.component;
+        }
+    }
+    CHECK(ordered, context + " run order");
+    CHECK(covered == labels, context + " runs");
+}
+
+}
+
+void checkBitplaneAnalysis()
+{
+    const PixelDecoder::Isa previous = PixelDecoder::isa();
+    const int sizes[][2] = { { 1, 1 }, { 5, 9 }, { 63, 4 }, { 64, 17 }, { 65, 30 },
+                             { 130, 41 }, { 257, 3 } };
+    std::mt19937 random(11);
+
+    for (int isa = PixelDecoder::SCALAR; isa <= PixelDecoder::detectedIsa(); ++isa) {
+        PixelDecoder::setIsa(PixelDecoder::Isa(isa));
+        for (const auto &size : sizes) {
+            checkCounts(PixelDecoder::Isa(isa), randomImage(size[0], size[1], 0.4, random));
+        }
+        checkCounts(PixelDecoder::Isa(isa), randomImage(200, 5, 1.0, random));
+    }
+    PixelDecoder::setIsa(previous);
+
+    for (const auto &size : sizes) {
+        for (double density : { 0.0, 0.02, 0.3, 0.55, 1.0 }) {
+            const Bitplane pixels = randomImage(size[0], size[1], density, random);
+            checkBoundingBox(pixels);
+            checkComponents(pixels, BitplaneAnalysis::FOUR);
+            checkComponents(pixels, BitplaneAnalysis::EIGHT);
+        }
+    }
+
+    // Touching only at a corner across a word boundary.
+    Bitplane diagonal(130, 2);
+    diagonal.set(63, 0, true);
+    diagonal.set(64, 1, true);
+    checkComponents(diagonal, BitplaneAnalysis::FOUR);
+    checkComponents(diagonal, BitplaneAnalysis::EIGHT);
+}
@@ -0,0 +1,156 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * IconArena alignment, block reuse and concurrent allocation, and icons
+ * loaded into an arena.
+ */
+
+#include "Check.h"
+#include "IconArena.h"
+#include "SimpleIcon.h"
+#include "bench/IconGenerator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * Fill allocations with their index and look for overwritten ones.
+ */
+struct Allocation
+{
+    unsigned char *data;
+    size_t bytes;
+};
+
+bool intact(const std::vector<Allocation> &allocations)
+{
+    for (size_t i = 0; i < allocations.size(); ++i) {
+        for (size_t k = 0; k < allocations[i].bytes; ++k) {
+            if (allocations[i].data[k] != (unsigned char)(i)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void checkAllocate()
+{
+    IconArena arena(4096);
+    std::vector<Allocation> allocations;
+    bool aligned = true;
+    for (size_t i = 0; i < 200; ++i) {
+        const size_t alignment = size_t(1) << (i % 7);
+        const size_t bytes = i % 13 == 0 ? 5000 : 1 + (i * 37) % 300;
+        unsigned char *data = static_cast<unsigned char *>(arena.allocate(bytes, alignment));
+        if (!CHECK(data != 0, "allocate " + std::to_string(bytes))) {
+            return;
+        }
+        aligned = aligned && reinterpret_cast<uintptr_t>(data) % alignment == 0;
+        std::memset(data, int(i & 0xff), bytes);
+        allocations.push_back(Allocation{ data, bytes });
+    }
+    CHECK(aligned, "alignment");
+    CHECK(intact(allocations), "overlap");
+    CHECK(arena.blockCount() > 1, "blocks");
+
+    // Blocks are kept for reuse until release().
+    const size_t blocks = arena.blockCount();
+    arena.reset();
+    CHECK(arena.bytesUsed() == 0 && arena.blockCount() == blocks, "reset");
+    CHECK(arena.allocate(100, 64) != 0 && arena.blockCount() == blocks, "reuse");
+    arena.release();
+    CHECK(arena.blockCount() == 0 && arena.bytesUsed() == 0, "release");
+
+    const std::string_view name = arena.copy("Schwert");
+    CHECK(name == "Schwert", "copy");
+    CHECK(arena.copy(std::string_view()).empty(), "copy empty");
+}
+
+void checkThreads()
+{
+    const int threadCount = 4;
+    const size_t perThread = 500;
+    IconArena arena(8192);
+    std::vector<std::vector<Allocation>> allocations(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&arena, &allocations, t, perThread] {
+            for (size_t i = 0; i < perThread; ++i) {
+                const size_t bytes = 1 + (i * 29 + size_t(t)) % 200;
+                unsigned char *data = static_cast<unsigned char *>(arena.allocate(bytes, 8));
+                if (data == 0) {
+                    return;
+                }
+                std::memset(data, int(i & 0xff), bytes);
+                allocations[size_t(t)].push_back(Allocation{ data, bytes });
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < threadCount; ++t) {
+        CHECK(allocations[size_t(t)].size() == perThread && intact(allocations[size_t(t)]),
+              "thread " + std::to_string(t));
+    }
+}
+
+void checkIcons()
+{
+    IconArena arena;
+    const IconGenerator generator(77, 31, 0.4, 3);
+    const string text = "Arena;;2;;77x31;;" + generator.payload(2);
+
+    SimpleIcon copy;
+    {
+        SimpleIcon icon(arena);
+        if (!CHECK(icon.loadFromMemory(text), "load")) {
+            return;
+        }
+        CHECK(icon.name() == "Arena" && Check::samePixels(icon.pixels(), generator.pixels()),
+              "load");
+        CHECK(arena.bytesUsed() >= icon.pixels().sizeInBytes(), "pixels in the arena");
+        copy = icon;
+    }
+
+    // Copies do not use the arena, so they survive its reset.
+    arena.reset();
+    std::memset(arena.allocate(arena.blockSize(), 64), 0xff, arena.blockSize());
+    CHECK(copy.name() == "Arena" && Check::samePixels(copy.pixels(), generator.pixels()),
+          "copy after reset");
+}
+
+}
+
+void checkIconArena()
+{
+    checkAllocate();
+    checkThreads();
+    checkIcons();
+}
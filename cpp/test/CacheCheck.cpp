@@ -0,0 +1,173 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * SimpleIconCache hits, eviction, coalescing of concurrent misses and
+ * loaders that throw.
+ */
+
+#include "Check.h"
+#include "SimpleIcon.h"
+#include "SimpleIconCache.h"
+#include "bench/IconGenerator.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * Wait until a condition holds, at most about a second.
+ */
+template<typename Condition>
+bool eventually(Condition condition)
+{
+    for (int i = 0; i < 1000 && !condition(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return condition();
+}
+
+SimpleIconCache::Handle loadFile(const string &file)
+{
+    return std::make_shared<const SimpleIcon>(file);
+}
+
+}
+
+void checkSimpleIconCache()
+{
+    char directory[] = "/tmp/SimpleIconCheck.XXXXXX";
+    if (!CHECK(::mkdtemp(directory) != 0, "temporary directory")) {
+        return;
+    }
+    const string first = string(directory) + "/first.txt";
+    const string second = string(directory) + "/second.txt";
+    CHECK(SimpleIcon("First", 1, IconGenerator(40, 30, 0.5, 1).pixels()).saveToFile(first, 1),
+          first);
+    CHECK(SimpleIcon("Second", 2, IconGenerator(40, 30, 0.5, 2).pixels()).saveToFile(second, 2),
+          second);
+
+    // Hits and eviction: the budget holds one of the two icons.
+    {
+        const size_t cost = SimpleIconCache::costOf(SimpleIcon(first));
+        SimpleIconCache cache(cost + cost / 2);
+        SimpleIconCache::Handle a = cache.get(first);
+        CHECK(a->error() == SimpleIcon::Error::NO_ERROR && a->name() == "First", first);
+        CHECK(cache.get(first) == a, "hit returns the cached icon");
+        SimpleIconCache::Handle b = cache.get(second);
+        SimpleIconCache::Stats stats = cache.stats();
+        CHECK(stats.hits == 1 && stats.misses == 2, "hit and miss counts");
+        CHECK(stats.evictions == 1 && stats.entries == 1 && stats.bytes <= cache.budget(),
+              "least recently used entry evicted");
+        CHECK(a->name() == "First" && a->pixels().width() == 40, "evicted handle stays valid");
+        CHECK(cache.get(first) != a, "evicted entry is decoded again");
+
+        SimpleIconCache::Handle missing = cache.get(string(directory) + "/missing.txt");
+        CHECK(missing && missing->error() != SimpleIcon::Error::NO_ERROR, "missing file");
+        CHECK(cache.stats().entries == 1, "failed load not cached");
+    }
+
+    // Concurrent misses wait for a single decode.
+    {
+        std::atomic<int> loads(0);
+        std::atomic<bool> release(false);
+        SimpleIconCache cache(SimpleIconCache::DEFAULT_BUDGET, [&](const string &file) {
+            ++loads;
+            while (!release) {
+                std::this_thread::yield();
+            }
+            return loadFile(file);
+        });
+
+        std::vector<SimpleIconCache::Handle> handles(4);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < handles.size(); ++i) {
+            threads.emplace_back([&, i] { handles[i] = cache.get(first); });
+        }
+        CHECK(eventually([&] { return cache.stats().coalesced == handles.size() - 1; }),
+              "callers coalesced");
+        release = true;
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        CHECK(loads == 1, "decoded once");
+        for (const SimpleIconCache::Handle &handle : handles) {
+            CHECK(handle == handles.front(), "same icon for every caller");
+        }
+    }
+
+    // A throwing loader reaches every waiting caller, and a later get()
+    // tries again instead of finding a broken promise.
+    {
+        std::atomic<int> loads(0);
+        std::atomic<bool> release(false);
+        SimpleIconCache cache(SimpleIconCache::DEFAULT_BUDGET, [&](const string &file) {
+            if (++loads == 1) {
+                while (!release) {
+                    std::this_thread::yield();
+                }
+                throw std::bad_alloc();
+            }
+            return loadFile(file);
+        });
+
+        std::atomic<int> failed(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; ++i) {
+            threads.emplace_back([&] {
+                try {
+                    cache.get(first);
+                } catch (const std::bad_alloc &) {
+                    ++failed;
+                } catch (...) {
+                }
+            });
+        }
+        CHECK(eventually([&] { return cache.stats().coalesced == 2; }), "callers coalesced");
+        release = true;
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        CHECK(failed == 3, "exception passed to every caller");
+
+        SimpleIconCache::Handle icon;
+        try {
+            icon = cache.get(first);
+        } catch (...) {
+        }
+        CHECK(icon && icon->error() == SimpleIcon::Error::NO_ERROR, "retry after a failure");
+        CHECK(loads == 2 && cache.stats().entries == 1, "retry decoded and cached");
+    }
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+    ::rmdir(directory);
+}
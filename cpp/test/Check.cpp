@@ -0,0 +1,95 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Property checks for the SimpleIcon library, run by `make check`.
+ *
+ * Prints every failed condition and exits with status 1 if there was
+ * any, 0 otherwise.
+ */
+
+#include "Check.h"
+
+#include <cstring>
+
+#include <iostream>
+using std::cout;
+using std::endl;
+
+namespace {
+
+int sFailures = 0;
+
+}
+
+bool Check::verify(bool condition, const char *text, const char *file, int line,
+                   const string &context)
+{
+    if (!condition) {
+        ++sFailures;
+        std::cerr << file << ":" << line << ": " << text << " failed";
+        if (!context.empty()) {
+            std::cerr << " (" << context << ")";
+        }
+        std::cerr << endl;
+    }
+    return condition;
+}
+
+int Check::failures()
+{
+    return sFailures;
+}
+
+bool Check::samePixels(const Bitplane &a, const Bitplane &b)
+{
+    return a.width() == b.width() && a.height() == b.height()
+        && (a.empty() || std::memcmp(a.words(), b.words(), a.sizeInBytes()) == 0);
+}
+
+int main()
+{
+    const struct {
+        const char *name;
+        void (*run)();
+    } checks[] = {
+        { "PixelDecoder", checkPixelDecoder },
+        { "PixelEncoder", checkPixelEncoder },
+        { "IconIndex", checkIconIndex },
+        { "SharedIconStore", checkSharedIconStore },
+        { "SimpleIconCache", checkSimpleIconCache },
+        { "PayloadCodecs", checkPayloadCodecs },
+        { "BitplaneOps", checkBitplaneOps },
+        { "BitplaneAnalysis", checkBitplaneAnalysis },
+        { "Thumbnail", checkThumbnail },
+        { "EmbeddedIcon", checkEmbeddedIcon },
+        { "IconArena", checkIconArena },
+    };
+
+    for (const auto &check : checks) {
+        const int before = Check::failures();
+        check.run();
+        cout << (Check::failures() == before ? "ok      " : "FAILED  ") << check.name << endl;
+    }
+    return Check::failures() == 0 ? 0 : 1;
+}
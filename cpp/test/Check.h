@@ -0,0 +1,76 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <string>
+using std::string;
+
+#include "Bitplane.h"
+
+/**
+ * Minimal harness for the property checks run by `make check`.
+ *
+ * Each check file provides one function listed below, which is called by
+ * the driver in Check.cpp. CHECK() records a failure with its location
+ * and carries on, so one run reports every broken property.
+ */
+class Check
+{
+public:
+    /**
+     * Record the outcome of one condition.
+     * @return The condition
+     */
+    static bool verify(bool condition, const char *text, const char *file, int line,
+                       const string &context);
+
+    /**
+     * Number of failed conditions so far.
+     */
+    static int failures();
+
+    /**
+     * Whether two bitplanes have the same size and pixels.
+     */
+    static bool samePixels(const Bitplane &a, const Bitplane &b);
+};
+
+/** Check a condition; context names the case in the report. */
+#define CHECK(condition, context) \
+    Check::verify((condition), #condition, __FILE__, __LINE__, (context))
+
+void checkPixelDecoder();
+void checkPixelEncoder();
+void checkIconIndex();
+void checkSharedIconStore();
+void checkSimpleIconCache();
+void checkPayloadCodecs();
+void checkBitplaneOps();
+void checkBitplaneAnalysis();
+void checkThumbnail();
+void checkEmbeddedIcon();
+void checkIconArena();
+
+#endif
@@ -0,0 +1,165 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Round trips and corrupt input for the version 3 (RunLengthCodec) and
+ * version 4 (SparseBitplane) payloads, with widths that are not multiples
+ * of 8.
+ */
+
+#include "Check.h"
+#include "RunLengthCodec.h"
+#include "SimpleIcon.h"
+#include "SparseBitplane.h"
+
+#include <cstddef>
+#include <random>
+
+namespace {
+
+const int OK = SimpleIcon::Error::NO_ERROR;
+const int ILLEGAL = SimpleIcon::Error::ILLEGAL_INPUT_FORMAT;
+
+/**
+ * Random image; density 0 and 1 give empty and full images.
+ */
+Bitplane randomImage(int width, int height, double density, std::mt19937 &random)
+{
+    Bitplane pixels(width, height);
+    std::bernoulli_distribution pixel(density);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            pixels.set(x, y, pixel(random));
+        }
+    }
+    return pixels;
+}
+
+size_t countReference(const Bitplane &pixels)
+{
+    size_t count = 0;
+    for (int y = 0; y < pixels.height(); ++y) {
+        for (int x = 0; x < pixels.width(); ++x) {
+            count += pixels.get(x, y) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+string describe(int width, int height, double density)
+{
+    return std::to_string(width) + "x" + std::to_string(height) + " density " +
+           std::to_string(density);
+}
+
+int decodeRuns(const string &payload, int width, int height)
+{
+    Bitplane pixels(width, height);
+    return RunLengthCodec::decode(payload, pixels);
+}
+
+void checkRunLength(std::mt19937 &random)
+{
+    Bitplane sword(10, 3);
+    sword.set(2, 0, true);
+    sword.fillRange(1, 0, 10);
+    sword.set(2, 2, true);
+    CHECK(RunLengthCodec::encode(sword) == "2,1/0,10/2,1", "sword");
+    CHECK(RunLengthCodec::encode(Bitplane(10, 3)).empty(), "empty image");
+
+    for (int width : { 1, 7, 9, 63, 64, 65, 130 }) {
+        for (double density : { 0.0, 0.05, 0.5, 0.95, 1.0 }) {
+            const int height = 1 + int(random() % 9);
+            const Bitplane pixels = randomImage(width, height, density, random);
+            Bitplane decoded(width, height);
+            CHECK(RunLengthCodec::decode(RunLengthCodec::encode(pixels), decoded) == OK &&
+                  Check::samePixels(decoded, pixels), describe(width, height, density));
+        }
+    }
+
+    CHECK(decodeRuns("", 10, 3) == OK, "empty payload");
+    CHECK(decodeRuns("0,10//0,10", 10, 3) == OK, "empty middle row");
+    CHECK(decodeRuns("0,11", 10, 3) == ILLEGAL, "run past the width");
+    CHECK(decodeRuns("4,4,3", 10, 3) == ILLEGAL, "runs past the width");
+    CHECK(decodeRuns("99999999999999999999", 10, 3) == ILLEGAL, "overlong run");
+    CHECK(decodeRuns("///", 10, 3) == ILLEGAL, "too many rows");
+    CHECK(decodeRuns("2,x", 10, 3) == ILLEGAL, "letter");
+    CHECK(decodeRuns("2,-1", 10, 3) == ILLEGAL, "sign");
+    CHECK(decodeRuns("2,,1", 10, 3) == ILLEGAL, "empty run");
+    CHECK(decodeRuns("2 1", 10, 3) == ILLEGAL, "space");
+}
+
+int decodeTiles(const string &payload, int width, int height)
+{
+    SparseBitplane tiles;
+    return SparseBitplane::decode(payload, width, height, tiles);
+}
+
+void checkSparse(std::mt19937 &random)
+{
+    const int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 9, 17 }, { 13, 5 }, { 64, 9 },
+                             { 65, 65 }, { 150, 83 } };
+    for (const auto &size : sizes) {
+        for (double density : { 0.0, 0.01, 0.5, 1.0 }) {
+            const Bitplane pixels = randomImage(size[0], size[1], density, random);
+            const SparseBitplane sparse = SparseBitplane::fromBitplane(pixels);
+            const string context = describe(size[0], size[1], density);
+            CHECK(Check::samePixels(sparse.toBitplane(), pixels), context);
+            CHECK(sparse.count() == countReference(pixels), context);
+
+            SparseBitplane decoded;
+            CHECK(SparseBitplane::decode(sparse.encode(), size[0], size[1], decoded) == OK &&
+                  Check::samePixels(decoded.toBitplane(), pixels), context);
+        }
+    }
+
+    // 13x5 is 2x1 tiles.
+    CHECK(decodeTiles("00:", 13, 5) == OK, "empty image");
+    CHECK(decodeTiles("00", 13, 5) == ILLEGAL, "missing separator");
+    CHECK(decodeTiles("0:", 13, 5) == ILLEGAL, "short bitmap");
+    CHECK(decodeTiles("000:", 13, 5) == ILLEGAL, "long bitmap");
+    CHECK(decodeTiles("10:", 13, 5) == ILLEGAL, "missing tile");
+    CHECK(decodeTiles("10:00000000000000ff00", 13, 5) == ILLEGAL, "long tile");
+    CHECK(decodeTiles("10:000000000000000", 13, 5) == ILLEGAL, "short tile");
+    CHECK(decodeTiles("10:000000000000000g", 13, 5) == ILLEGAL, "tile letter");
+    CHECK(decodeTiles("00:0000000000000001", 13, 5) == ILLEGAL, "tile of an empty bitmap");
+
+    // Bits beyond the right and bottom edge are dropped.
+    SparseBitplane edge;
+    CHECK(SparseBitplane::decode("01:ffffffffffffffff", 13, 5, edge) == OK, "edge tile");
+    CHECK(edge.count() == 25 && edge.occupied(1, 0) && !edge.occupied(0, 0), "edge tile");
+    Bitplane expected(13, 5);
+    for (int y = 0; y < 5; ++y) {
+        expected.fillRange(y, 8, 13);
+    }
+    CHECK(Check::samePixels(edge.toBitplane(), expected), "edge tile");
+}
+
+}
+
+void checkPayloadCodecs()
+{
+    std::mt19937 random(5);
+    checkRunLength(random);
+    checkSparse(random);
+}
@@ -0,0 +1,205 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Cross-check of the PixelDecoder kernels: every instruction set the CPU
+ * supports must decode exactly like a naive reference of the format, for
+ * widths that are not multiples of 8 or 64 and for truncated payloads.
+ * The version 4 occupancy bitmap goes through the same packing kernel.
+ */
+
+#include "Check.h"
+#include "PixelDecoder.h"
+#include "SimpleIcon.h"
+#include "SparseBitplane.h"
+#include "bench/IconGenerator.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * Position of pixel (x, y) in a version 2 payload.
+ */
+size_t positionV2(int x, int y, int width, int height)
+{
+    const int block = x / 8;
+    const int blockWidth = width - block * 8 < 8 ? width - block * 8 : 8;
+    return size_t(block) * 8 * size_t(height) + size_t(y) * size_t(blockWidth) + size_t(x - block * 8);
+}
+
+/**
+ * Naive decoder, one pixel at a time.
+ */
+Bitplane reference(const string &payload, size_t length, int version, int width, int height)
+{
+    Bitplane pixels(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const size_t pos = version == 1 ? size_t(y) * size_t(width) + size_t(x)
+                                            : positionV2(x, y, width, height);
+            if (pos < length && payload[pos] == '1') {
+                pixels.set(x, y, true);
+            }
+        }
+    }
+    return pixels;
+}
+
+string describe(PixelDecoder::Isa isa, int version, int width, int height, size_t length)
+{
+    return string(PixelDecoder::isaName(isa)) + " v" + std::to_string(version) + " " +
+           std::to_string(width) + "x" + std::to_string(height) + " length " +
+           std::to_string(length);
+}
+
+void checkImage(PixelDecoder::Isa isa, int width, int height, std::mt19937 &random)
+{
+    const IconGenerator generator(width, height, double(random() % 101) / 100.0, random());
+    std::vector<uint64_t> row(static_cast<size_t>(Bitplane::strideFor(width)));
+
+    for (int version = 1; version <= 2; ++version) {
+        const string payload = generator.payload(version);
+        // The full payload, and one cut short at a random point.
+        const size_t lengths[] = { payload.size(), random() % (payload.size() + 1) };
+        for (size_t length : lengths) {
+            const string context = describe(isa, version, width, height, length);
+            const Bitplane expected = length == payload.size()
+                ? generator.pixels() : reference(payload, length, version, width, height);
+
+            Bitplane pixels(width, height);
+            if (version == 1) {
+                PixelDecoder::decodeV1(payload.data(), length, pixels);
+            } else {
+                PixelDecoder::decodeV2(payload.data(), length, pixels);
+            }
+            CHECK(Check::samePixels(pixels, expected), context);
+
+            bool rowsMatch = true;
+            for (int y = 0; y < height; ++y) {
+                if (version == 1) {
+                    PixelDecoder::decodeRowV1(payload.data(), length, width, y, row.data());
+                } else {
+                    PixelDecoder::decodeRowV2(payload.data(), length, width, height, y, row.data());
+                }
+                for (size_t word = 0; word < row.size(); ++word) {
+                    rowsMatch = rowsMatch && row[word] == expected.row(y)[word];
+                }
+            }
+            CHECK(rowsMatch, context + " row by row");
+        }
+    }
+}
+
+void checkKernels(PixelDecoder::Isa isa, std::mt19937 &random)
+{
+    char digits[64];
+    uint64_t in[8];
+    uint64_t out[8];
+    uint64_t back[8];
+    for (int round = 0; round < 1000; ++round) {
+        // Anything but '1' is a cleared pixel.
+        for (char &digit : digits) {
+            const unsigned pick = random() % 4;
+            digit = pick == 0 ? '0' : pick == 1 ? '1' : char(random());
+        }
+        CHECK(PixelDecoder::pack64(digits) == PixelDecoder::packScalar(digits, 64),
+              PixelDecoder::isaName(isa));
+
+        for (uint64_t &word : in) {
+            word = (uint64_t(random()) << 32) | random();
+        }
+        PixelDecoder::transpose8(in, out);
+        PixelDecoder::transpose8(out, back);
+        bool transposed = true;
+        for (int j = 0; j < 8; ++j) {
+            for (int k = 0; k < 8; ++k) {
+                transposed = transposed && ((out[j] >> (8 * k)) & 0xff) == ((in[k] >> (8 * j)) & 0xff);
+            }
+            transposed = transposed && back[j] == in[j];
+        }
+        CHECK(transposed, PixelDecoder::isaName(isa));
+    }
+}
+
+/**
+ * Version 4 payloads: the occupancy bitmap is packed by pack64, and any
+ * digit other than '0' or '1' must be rejected instead of read as a bit.
+ */
+void checkSparseBitmap(PixelDecoder::Isa isa, std::mt19937 &random)
+{
+    // 19x11 tiles, more than three words of occupancy bits. Every third
+    // tile is occupied, so a broken digit of an empty tile does not change
+    // the number of tiles that follow.
+    Bitplane pixels(150, 83);
+    const size_t tileCount = size_t(19) * 11;
+    for (size_t index = 0; index < tileCount; index += 3) {
+        pixels.set(int(index % 19) * 8 + int(random() % 6), int(index / 19) * 8 + int(random() % 3),
+                   true);
+    }
+    const string payload = SparseBitplane::fromBitplane(pixels).encode();
+    SparseBitplane tiles;
+    CHECK(SparseBitplane::decode(payload, 150, 83, tiles) == SimpleIcon::Error::NO_ERROR &&
+          Check::samePixels(tiles.toBitplane(), pixels), PixelDecoder::isaName(isa));
+
+    const char corrupt[] = { '2', 'x', '\0', '/', char(0xb1) };
+    for (size_t position : { size_t(0), size_t(63), size_t(64), size_t(130), tileCount - 1 }) {
+        for (char c : corrupt) {
+            string broken = payload;
+            broken[position] = c;
+            CHECK(SparseBitplane::decode(broken, 150, 83, tiles) ==
+                  SimpleIcon::Error::ILLEGAL_INPUT_FORMAT,
+                  string(PixelDecoder::isaName(isa)) + " bitmap digit " + std::to_string(position));
+        }
+    }
+}
+
+}
+
+void checkPixelDecoder()
+{
+    const PixelDecoder::Isa previous = PixelDecoder::isa();
+    const size_t threshold = PixelDecoder::parallelThreshold();
+    const int widths[] = { 1, 7, 8, 9, 15, 63, 64, 65, 71, 127, 129, 200, 513, 1031 };
+    std::mt19937 random(2);
+
+    for (int isa = PixelDecoder::SCALAR; isa <= PixelDecoder::detectedIsa(); ++isa) {
+        PixelDecoder::setIsa(PixelDecoder::Isa(isa));
+        checkKernels(PixelDecoder::Isa(isa), random);
+        checkSparseBitmap(PixelDecoder::Isa(isa), random);
+        for (int width : widths) {
+            checkImage(PixelDecoder::Isa(isa), width, 1 + int(random() % 37), random);
+        }
+        for (int round = 0; round < 100; ++round) {
+            checkImage(PixelDecoder::Isa(isa), 1 + int(random() % 300), 1 + int(random() % 70), random);
+        }
+
+        // Large enough to be decoded in bands.
+        PixelDecoder::setParallelThreshold(0);
+        checkImage(PixelDecoder::Isa(isa), 1001, 611, random);
+        PixelDecoder::setParallelThreshold(threshold);
+    }
+    PixelDecoder::setIsa(previous);
+}
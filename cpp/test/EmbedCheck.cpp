@@ -0,0 +1,100 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Icons embedded with SIMPLEICON_EMBED must match what the run time
+ * loader makes of the same text, in particular the version 2 column
+ * blocks of widths that are not multiples of 8.
+ */
+
+#include "Check.h"
+#include "EmbeddedIcon.h"
+#include "SimpleIcon.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// 13x5: one full and one 5 pixel wide column block.
+#define BLOCKS_TEXT "Blocks;;2;;13x5;;" \
+    "1000000101000010001000010001\n" \
+    "0010000100000000" \
+    "110011001111100000011"
+
+// 70x2: two row words, the last block 6 pixels wide.
+#define WIDE_TEXT "Wide;; 2 ;;70x2;;" \
+    "1100000000000011" "1010101001010101" "1111111100000000" "0000000111111111" \
+    "1000000100000001" "1111000011110000" "1100110000110011" "0101010110101010" \
+    "100001011110"
+
+#define ROWS_TEXT "Rows;;1;;9x2;;" \
+    "101010101" "\r\n" "010101011"
+
+template <int Width, int Height>
+void checkEmbedded(const EmbeddedIcon<Width, Height> &embedded, const char *text)
+{
+    const string context(embedded.name());
+    const SimpleIcon copy = embedded.icon();
+
+    for (SimpleIcon::LoadMode mode : { SimpleIcon::EAGER, SimpleIcon::LAZY }) {
+        SimpleIcon loaded;
+        if (!CHECK(loaded.loadFromMemory(text, mode), context)) {
+            continue;
+        }
+        CHECK(embedded.name() == loaded.name() && embedded.fileVersion() == loaded.fileVersion() &&
+              embedded.width() == loaded.width() && embedded.height() == loaded.height(), context);
+        CHECK(Check::samePixels(copy.pixels(), loaded.pixels()), context);
+
+        bool samePixels = true;
+        std::vector<uint64_t> row(size_t(EmbeddedIcon<Width, Height>::STRIDE));
+        for (int y = 0; y < Height; ++y) {
+            embedded.readRow(y, row.data());
+            for (int x = 0; x < Width; ++x) {
+                samePixels = samePixels && embedded.pixel(x, y) == loaded.pixels().get(x, y) &&
+                             bool((row[size_t(x >> 6)] >> (x & 63)) & 1) == embedded.pixel(x, y);
+            }
+        }
+        CHECK(samePixels, context);
+    }
+}
+
+}
+
+void checkEmbeddedIcon()
+{
+    constexpr auto SWORD = SIMPLEICON_EMBED("Schwert;;2;;10x3;;"
+                                            "001000001111111100100000001100");
+    constexpr auto BLOCKS = SIMPLEICON_EMBED(BLOCKS_TEXT);
+    constexpr auto WIDE = SIMPLEICON_EMBED(WIDE_TEXT);
+    constexpr auto ROWS = SIMPLEICON_EMBED(ROWS_TEXT);
+
+    // Decoded at compile time.
+    static_assert(SWORD.pixel(2, 0) && SWORD.pixel(9, 1) && !SWORD.pixel(3, 2), "sword");
+    static_assert(BLOCKS.pixel(7, 0) && !BLOCKS.pixel(8, 0) && BLOCKS.pixel(12, 0), "blocks");
+
+    checkEmbedded(SWORD, "Schwert;;2;;10x3;;001000001111111100100000001100");
+    checkEmbedded(BLOCKS, BLOCKS_TEXT);
+    checkEmbedded(WIDE, WIDE_TEXT);
+    checkEmbedded(ROWS, ROWS_TEXT);
+}
@@ -0,0 +1,121 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Round trips through the encoders: every file version written by
+ * SimpleIcon::encode(), and the binary format, must read back as the
+ * pixels it was written from, with every instruction set.
+ */
+
+#include "Check.h"
+#include "BinaryFormat.h"
+#include "PixelDecoder.h"
+#include "PixelEncoder.h"
+#include "SimpleIcon.h"
+#include "bench/IconGenerator.h"
+
+#include <random>
+
+namespace {
+
+string describe(PixelDecoder::Isa isa, const string &format, int width, int height)
+{
+    return string(PixelDecoder::isaName(isa)) + " " + format + " " +
+           std::to_string(width) + "x" + std::to_string(height);
+}
+
+void checkRoundTrip(PixelDecoder::Isa isa, int width, int height, std::mt19937 &random)
+{
+    const IconGenerator generator(width, height, double(random() % 101) / 100.0, random());
+    const SimpleIcon icon("Generated", 1, generator.pixels());
+
+    for (int version = 1; version <= 4; ++version) {
+        const string context = describe(isa, "v" + std::to_string(version), width, height);
+        string content;
+        if (!CHECK(icon.encode(version, content), context)) {
+            continue;
+        }
+        if (version <= 2) {
+            CHECK(content == generator.text(version), context);
+        }
+
+        SimpleIcon eager;
+        CHECK(eager.loadFromMemory(content), context);
+        CHECK(eager.fileVersion() == version, context);
+        CHECK(Check::samePixels(eager.pixels(), generator.pixels()), context);
+
+        SimpleIcon lazy;
+        CHECK(lazy.loadFromMemory(content, SimpleIcon::LAZY), context + " lazy");
+        CHECK(Check::samePixels(lazy.pixels(), generator.pixels()), context + " lazy");
+    }
+
+    const string context = describe(isa, "binary", width, height);
+    SimpleIcon binary;
+    CHECK(binary.loadFromMemory(BinaryFormat::encode("Generated", 1, generator.pixels())), context);
+    CHECK(Check::samePixels(binary.pixels(), generator.pixels()), context);
+}
+
+void checkUnpack(PixelDecoder::Isa isa, std::mt19937 &random)
+{
+    char digits[64];
+    for (int round = 0; round < 1000; ++round) {
+        const uint64_t bits = (uint64_t(random()) << 32) | random();
+        PixelEncoder::unpack64(bits, digits);
+        bool same = true;
+        for (int i = 0; i < 64; ++i) {
+            same = same && digits[i] == ((bits >> i) & 1 ? '1' : '0');
+        }
+        CHECK(same && PixelDecoder::pack64(digits) == bits, PixelDecoder::isaName(isa));
+    }
+}
+
+}
+
+void checkPixelEncoder()
+{
+    const PixelDecoder::Isa previous = PixelDecoder::isa();
+    const size_t threshold = PixelDecoder::parallelThreshold();
+    const int widths[] = { 1, 7, 8, 9, 15, 63, 64, 65, 71, 127, 129, 200, 513, 1031 };
+    std::mt19937 random(24);
+
+    for (int isa = PixelDecoder::SCALAR; isa <= PixelDecoder::detectedIsa(); ++isa) {
+        PixelDecoder::setIsa(PixelDecoder::Isa(isa));
+        checkUnpack(PixelDecoder::Isa(isa), random);
+        for (int width : widths) {
+            checkRoundTrip(PixelDecoder::Isa(isa), width, 1 + int(random() % 37), random);
+        }
+        for (int round = 0; round < 100; ++round) {
+            checkRoundTrip(PixelDecoder::Isa(isa), 1 + int(random() % 300), 1 + int(random() % 70), random);
+        }
+
+        // Large enough to be encoded in bands.
+        PixelDecoder::setParallelThreshold(0);
+        checkRoundTrip(PixelDecoder::Isa(isa), 1001, 611, random);
+        PixelDecoder::setParallelThreshold(threshold);
+    }
+    PixelDecoder::setIsa(previous);
+
+    SimpleIcon icon("Generated", 1, IconGenerator(9, 9, 0.5).pixels());
+    string content;
+    CHECK(!icon.encode(0, content) && !icon.encode(5, content), "unknown versions");
+}
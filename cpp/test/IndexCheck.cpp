@@ -0,0 +1,112 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * IconIndex over every kind of file it can meet: text icons of all
+ * versions, binary icons and atlas files with their longer header, and
+ * files of newer versions it must skip.
+ */
+
+#include "BinaryFormat.h"
+#include "Check.h"
+#include "IconAtlas.h"
+#include "IconIndex.h"
+#include "SimpleIcon.h"
+#include "bench/IconGenerator.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <vector>
+
+void checkIconIndex()
+{
+    char directory[] = "/tmp/SimpleIconCheck.XXXXXX";
+    if (!CHECK(::mkdtemp(directory) != 0, "temporary directory")) {
+        return;
+    }
+    const string base = string(directory) + "/";
+    std::vector<string> files;
+
+    for (int version = 1; version <= 4; ++version) {
+        const SimpleIcon icon("Text" + std::to_string(version), version,
+                              IconGenerator(10 + version, 7, 0.5, unsigned(version)).pixels());
+        files.push_back(base + "text" + std::to_string(version) + ".txt");
+        CHECK(icon.saveToFile(files.back(), version), files.back());
+    }
+
+    const SimpleIcon binary("Binary", 1, IconGenerator(70, 3, 0.5).pixels());
+    files.push_back(base + "binary.sib");
+    CHECK(binary.saveBinary(files.back()), files.back());
+
+    IconAtlas atlas;
+    atlas.add(binary);
+    atlas.add(SimpleIcon("Other", 2, IconGenerator(5, 9, 0.5).pixels()));
+    files.push_back(base + "icons.atlas");
+    CHECK(atlas.build("Atlas") && atlas.save(files.back()), files.back());
+
+    IconIndex index;
+    CHECK(index.addDirectory(directory), directory);
+    CHECK(index.size() == files.size(), std::to_string(index.size()) + " entries");
+
+    // Newer file versions cannot be loaded, so they are not indexed.
+    const string future = base + "future.txt";
+    const string futureBinary = base + "future.sib";
+    CHECK(BinaryFormat::writeAll(future, "Future;;5;;3x1;;101"), future);
+    CHECK(BinaryFormat::writeAll(futureBinary,
+                                 BinaryFormat::encode("Future", 5, IconGenerator(3, 1, 0.5).pixels())),
+          futureBinary);
+    CHECK(index.addFile(future) == SimpleIcon::Error::ILLEGAL_INPUT_FORMAT, future);
+    CHECK(index.addFile(futureBinary) == SimpleIcon::Error::ILLEGAL_INPUT_FORMAT, futureBinary);
+    CHECK(index.size() == files.size(), "newer file versions skipped");
+    std::remove(future.c_str());
+    std::remove(futureBinary.c_str());
+
+    const string indexFile = base + "index";
+    IconIndex loaded;
+    CHECK(index.save(indexFile) && loaded.load(indexFile), indexFile);
+    CHECK(loaded.size() == index.size(), indexFile);
+
+    for (const string &file : files) {
+        SimpleIcon icon;
+        CHECK(icon.loadFromFile(file), file);
+        IconIndex::Query query;
+        query.name = string(icon.name());
+        const std::vector<const IconIndex::Entry *> found = loaded.find(query);
+        if (!CHECK(found.size() == 1, file)) {
+            continue;
+        }
+        const IconIndex::Entry &entry = *found.front();
+        CHECK(entry.file() == file, file);
+        CHECK(entry.width() == icon.width() && entry.height() == icon.height(), file);
+        CHECK(entry.fileVersion() == icon.fileVersion(), file);
+        CHECK(entry.isBinary() == (file.find(".txt") == string::npos), file);
+    }
+
+    files.push_back(indexFile);
+    for (const string &file : files) {
+        std::remove(file.c_str());
+    }
+    ::rmdir(directory);
+}
@@ -0,0 +1,222 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * BitplaneOps against a naive reference working one pixel at a time, for
+ * sizes around the 64 pixel word and block boundaries. Comparing whole
+ * words also checks that padding bits stay cleared.
+ */
+
+#include "Check.h"
+#include "BitplaneOps.h"
+#include "PixelDecoder.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+Bitplane randomImage(int width, int height, std::mt19937 &random)
+{
+    Bitplane pixels(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            pixels.set(x, y, random() % 3 == 0);
+        }
+    }
+    return pixels;
+}
+
+bool apply(BitplaneOps::Op op, bool target, bool source)
+{
+    switch (op) {
+    case BitplaneOps::COPY: return source;
+    case BitplaneOps::AND: return target && source;
+    case BitplaneOps::OR: return target || source;
+    case BitplaneOps::XOR: return target != source;
+    case BitplaneOps::AND_NOT: return target && !source;
+    }
+    return target;
+}
+
+Bitplane combineReference(const Bitplane &target, const Bitplane &source,
+                          BitplaneOps::Op op, int x, int y)
+{
+    Bitplane result(target.width(), target.height());
+    for (int ty = 0; ty < target.height(); ++ty) {
+        for (int tx = 0; tx < target.width(); ++tx) {
+            const int sx = tx - x;
+            const int sy = ty - y;
+            const bool inside = sx >= 0 && sy >= 0 && sx < source.width() && sy < source.height();
+            result.set(tx, ty, inside ? apply(op, target.get(tx, ty), source.get(sx, sy))
+                                      : target.get(tx, ty));
+        }
+    }
+    return result;
+}
+
+Bitplane cropReference(const Bitplane &pixels, int x, int y, int width, int height)
+{
+    const int left = std::max(x, 0);
+    const int top = std::max(y, 0);
+    const int right = std::min(x + width, pixels.width());
+    const int bottom = std::min(y + height, pixels.height());
+    if (right <= left || bottom <= top) {
+        return Bitplane();
+    }
+    Bitplane result(right - left, bottom - top);
+    for (int cy = top; cy < bottom; ++cy) {
+        for (int cx = left; cx < right; ++cx) {
+            result.set(cx - left, cy - top, pixels.get(cx, cy));
+        }
+    }
+    return result;
+}
+
+/**
+ * Move every pixel (x, y) to map(x, y) in an image of the given size.
+ */
+template <typename Map>
+Bitplane remapReference(const Bitplane &pixels, int width, int height, Map map)
+{
+    Bitplane result(width, height);
+    for (int y = 0; y < pixels.height(); ++y) {
+        for (int x = 0; x < pixels.width(); ++x) {
+            int rx = 0;
+            int ry = 0;
+            map(x, y, rx, ry);
+            result.set(rx, ry, pixels.get(x, y));
+        }
+    }
+    return result;
+}
+
+string describe(const Bitplane &pixels, const char *operation)
+{
+    return string(operation) + " " + std::to_string(pixels.width()) + "x" +
+           std::to_string(pixels.height());
+}
+
+void checkGeometry(const Bitplane &pixels)
+{
+    const int w = pixels.width();
+    const int h = pixels.height();
+
+    CHECK(Check::samePixels(BitplaneOps::transpose(pixels),
+                            remapReference(pixels, h, w, [](int x, int y, int &rx, int &ry) {
+                                rx = y;
+                                ry = x;
+                            })), describe(pixels, "transpose"));
+    CHECK(Check::samePixels(BitplaneOps::rotate90(pixels, true),
+                            remapReference(pixels, h, w, [h](int x, int y, int &rx, int &ry) {
+                                rx = h - 1 - y;
+                                ry = x;
+                            })), describe(pixels, "rotate clockwise"));
+    CHECK(Check::samePixels(BitplaneOps::rotate90(pixels, false),
+                            remapReference(pixels, h, w, [w](int x, int y, int &rx, int &ry) {
+                                rx = y;
+                                ry = w - 1 - x;
+                            })), describe(pixels, "rotate counterclockwise"));
+
+    Bitplane flipped = pixels;
+    CHECK(BitplaneOps::flipHorizontal(flipped) &&
+          Check::samePixels(flipped, remapReference(pixels, w, h, [w](int x, int y, int &rx, int &ry) {
+              rx = w - 1 - x;
+              ry = y;
+          })), describe(pixels, "flip horizontal"));
+    flipped = pixels;
+    CHECK(BitplaneOps::flipVertical(flipped) &&
+          Check::samePixels(flipped, remapReference(pixels, w, h, [h](int x, int y, int &rx, int &ry) {
+              rx = x;
+              ry = h - 1 - y;
+          })), describe(pixels, "flip vertical"));
+
+    Bitplane inverted = pixels;
+    Bitplane expected(w, h);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            expected.set(x, y, !pixels.get(x, y));
+        }
+    }
+    CHECK(BitplaneOps::invert(inverted) && Check::samePixels(inverted, expected),
+          describe(pixels, "invert"));
+
+    const int rects[][4] = { { 0, 0, w, h }, { 1, 1, w - 2, h - 2 }, { w / 2, 0, w, h },
+                             { -5, -3, 70, 9 }, { 63, h / 3, 66, 2 }, { w, 0, 4, 4 },
+                             { 0, 0, 0, h }, { -10, 0, 10, h } };
+    for (const auto &rect : rects) {
+        CHECK(Check::samePixels(BitplaneOps::crop(pixels, rect[0], rect[1], rect[2], rect[3]),
+                                cropReference(pixels, rect[0], rect[1], rect[2], rect[3])),
+              describe(pixels, "crop") + " at " + std::to_string(rect[0]) + "," +
+              std::to_string(rect[1]) + " size " + std::to_string(rect[2]) + "x" +
+              std::to_string(rect[3]));
+    }
+}
+
+void checkCombine(PixelDecoder::Isa isa, const Bitplane &target, const Bitplane &source,
+                  std::mt19937 &random)
+{
+    const int offsets[][2] = { { 0, 0 }, { 1, 0 }, { -1, 2 }, { 63, -3 }, { 64, 1 },
+                               { -65, 0 }, { int(random() % 200) - 100, int(random() % 20) - 10 } };
+    for (const auto &offset : offsets) {
+        for (int op = BitplaneOps::COPY; op <= BitplaneOps::AND_NOT; ++op) {
+            Bitplane result = target;
+            const Bitplane shared = result;
+            CHECK(BitplaneOps::combine(result, source, BitplaneOps::Op(op), offset[0], offset[1]) &&
+                  Check::samePixels(result, combineReference(target, source, BitplaneOps::Op(op),
+                                                             offset[0], offset[1])) &&
+                  Check::samePixels(shared, target),
+                  string(PixelDecoder::isaName(isa)) + " " + describe(target, "combine") +
+                  " op " + std::to_string(op) + " at " + std::to_string(offset[0]) + "," +
+                  std::to_string(offset[1]));
+        }
+    }
+
+    // A source sharing the target's pixels.
+    Bitplane self = target;
+    CHECK(BitplaneOps::combine(self, self, BitplaneOps::XOR, 3, 1) &&
+          Check::samePixels(self, combineReference(target, target, BitplaneOps::XOR, 3, 1)),
+          string(PixelDecoder::isaName(isa)) + " " + describe(target, "combine with itself"));
+}
+
+}
+
+void checkBitplaneOps()
+{
+    const PixelDecoder::Isa previous = PixelDecoder::isa();
+    const int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 64, 64 }, { 65, 63 }, { 130, 70 },
+                             { 200, 3 }, { 3, 200 }, { 129, 129 } };
+    std::mt19937 random(7);
+
+    for (const auto &size : sizes) {
+        checkGeometry(randomImage(size[0], size[1], random));
+    }
+    for (int isa = PixelDecoder::SCALAR; isa <= PixelDecoder::detectedIsa(); ++isa) {
+        PixelDecoder::setIsa(PixelDecoder::Isa(isa));
+        checkCombine(PixelDecoder::Isa(isa), randomImage(300, 20, random),
+                     randomImage(100, 7, random), random);
+        checkCombine(PixelDecoder::Isa(isa), randomImage(70, 9, random),
+                     randomImage(130, 15, random), random);
+    }
+    PixelDecoder::setIsa(previous);
+}
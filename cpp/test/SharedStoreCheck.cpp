@@ -0,0 +1,105 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * SharedIconStore generations: icons read back as published, and icons
+ * taken from a generation stay valid after a reload replaced it.
+ */
+
+#include "Check.h"
+#include "SharedIconStore.h"
+#include "SimpleIcon.h"
+#include "bench/IconGenerator.h"
+
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+namespace {
+
+std::vector<SimpleIcon> library(int count, unsigned seed)
+{
+    std::vector<SimpleIcon> icons;
+    for (int i = 0; i < count; ++i) {
+        // Every third image repeats, so some are stored once.
+        icons.emplace_back("icon" + std::to_string(i), 1 + i % 4,
+                           IconGenerator(1 + i * 7 % 90, 1 + i * 5 % 40, 0.4,
+                                         seed + unsigned(i % 3 == 2 ? 0 : i)).pixels());
+    }
+    return icons;
+}
+
+}
+
+void checkSharedIconStore()
+{
+    const string name = "/SimpleIconCheck." + std::to_string(::getpid());
+    SharedIconStore writer(name);
+    SharedIconStore reader(name);
+
+    const std::vector<SimpleIcon> first = library(40, 1);
+    for (const SimpleIcon &icon : first) {
+        writer.add(icon);
+    }
+    CHECK(!writer.add(first.front()), "duplicate name");
+    CHECK(writer.publish() == 1, name);
+    CHECK(reader.attach() && reader.current()->number() == 1, name);
+
+    // Taken from generation 1, which goes away with the next refresh().
+    std::vector<SimpleIcon> taken(first.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        const string context = string(first[i].name());
+        CHECK(reader.current()->find(first[i].name(), taken[i]), context);
+        CHECK(taken[i].pixels().isView(), context);
+        CHECK(taken[i].fileVersion() == first[i].fileVersion(), context);
+    }
+
+    const std::vector<SimpleIcon> second = library(25, 100);
+    for (const SimpleIcon &icon : second) {
+        writer.add(icon);
+    }
+    CHECK(writer.publish() == 2, name);
+    CHECK(reader.refresh() && reader.current()->number() == 2, name);
+    CHECK(!reader.refresh(), name);
+    CHECK(reader.current()->size() == second.size(), name);
+
+    for (size_t i = 0; i < first.size(); ++i) {
+        CHECK(Check::samePixels(taken[i].pixels(), first[i].pixels()), string(first[i].name()));
+    }
+    for (const SimpleIcon &icon : second) {
+        SimpleIcon found;
+        CHECK(reader.current()->find(icon.name(), found)
+              && Check::samePixels(found.pixels(), icon.pixels()), string(icon.name()));
+    }
+    SimpleIcon missing;
+    CHECK(!reader.current()->find("missing", missing), name);
+
+    // Modifying a view copies it instead of writing to the segment.
+    SimpleIcon changed = taken.front();
+    taken.front().invert();
+    CHECK(!taken.front().pixels().isView(), name);
+    CHECK(Check::samePixels(changed.pixels(), first.front().pixels()), name);
+
+    CHECK(writer.unlink(), name);
+}
@@ -0,0 +1,182 @@
+/* Copyright (C) 2013 Maurice Bleuel <mandrakey@lavabit.com>
+ *
+ * This file is part of SimpleIcon, C++ STL version.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Thumbnails against a naive box filter, built from decoded rows and
+ * straight from (possibly truncated) version 2 payloads for every
+ * instruction set, and the bounds of the upscaled display.
+ */
+
+#include "Check.h"
+#include "PixelDecoder.h"
+#include "SimpleIcon.h"
+#include "Thumbnail.h"
+#include "bench/IconGenerator.h"
+
+#include <algorithm>
+#include <climits>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * Count the set pixels of every factor x factor block.
+ */
+std::vector<uint32_t> boxReference(const Bitplane &pixels, int factor)
+{
+    const int width = (pixels.width() + factor - 1) / factor;
+    const int height = (pixels.height() + factor - 1) / factor;
+    std::vector<uint32_t> counts(size_t(width) * size_t(height), 0);
+    for (int y = 0; y < pixels.height(); ++y) {
+        for (int x = 0; x < pixels.width(); ++x) {
+            if (pixels.get(x, y)) {
+                ++counts[size_t(y / factor) * size_t(width) + size_t(x / factor)];
+            }
+        }
+    }
+    return counts;
+}
+
+bool sameCounts(const Thumbnail &thumbnail, const std::vector<uint32_t> &counts)
+{
+    if (size_t(thumbnail.width()) * size_t(thumbnail.height()) != counts.size()) {
+        return false;
+    }
+    for (int y = 0; y < thumbnail.height(); ++y) {
+        for (int x = 0; x < thumbnail.width(); ++x) {
+            if (thumbnail.count(x, y) != counts[size_t(y) * size_t(thumbnail.width()) + size_t(x)]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * The pixels a version 2 payload cut after length digits decodes to.
+ */
+Bitplane truncatedV2(const Bitplane &pixels, size_t length)
+{
+    Bitplane result(pixels.width(), pixels.height());
+    for (int y = 0; y < pixels.height(); ++y) {
+        for (int x = 0; x < pixels.width(); ++x) {
+            const int block = x / 8;
+            const int blockWidth = std::min(8, pixels.width() - block * 8);
+            const size_t pos = size_t(block) * 8 * size_t(pixels.height()) +
+                               size_t(y) * size_t(blockWidth) + size_t(x - block * 8);
+            result.set(x, y, pos < length && pixels.get(x, y));
+        }
+    }
+    return result;
+}
+
+string describe(PixelDecoder::Isa isa, int width, int height, int factor)
+{
+    return string(PixelDecoder::isaName(isa)) + " " + std::to_string(width) + "x" +
+           std::to_string(height) + " factor " + std::to_string(factor);
+}
+
+void checkImage(PixelDecoder::Isa isa, int width, int height, std::mt19937 &random)
+{
+    const IconGenerator generator(width, height, double(random() % 101) / 100.0, random());
+    const Bitplane &pixels = generator.pixels();
+    const string payload = generator.payload(2);
+
+    for (int factor : { 1, 2, 3, 7, 8, 16, 24, 63, 64, 65, 100 }) {
+        const string context = describe(isa, width, height, factor);
+        const std::vector<uint32_t> counts = boxReference(pixels, factor);
+        CHECK(sameCounts(Thumbnail::fromBitplane(pixels, factor), counts), context);
+        CHECK(sameCounts(Thumbnail::fromV2(payload.data(), payload.size(), width, height, factor),
+                         counts), context + " v2");
+
+        const size_t length = random() % (payload.size() + 1);
+        CHECK(sameCounts(Thumbnail::fromV2(payload.data(), length, width, height, factor),
+                         boxReference(truncatedV2(pixels, length), factor)),
+              context + " v2 length " + std::to_string(length));
+    }
+}
+
+void checkLevels()
+{
+    // 10x5 at factor 4: 3x2 blocks, the right and bottom ones partial.
+    Bitplane pixels(10, 5);
+    for (int y = 0; y < 5; ++y) {
+        pixels.fillRange(y, 4, 10);
+    }
+    pixels.set(0, 0, true);
+    const Thumbnail thumbnail = Thumbnail::fromBitplane(pixels, 4);
+    CHECK(thumbnail.width() == 3 && thumbnail.height() == 2, "levels");
+    CHECK(thumbnail.level(0, 0) == (Thumbnail::MAX_LEVEL + 8) / 16, "levels");
+    CHECK(thumbnail.level(0, 1) == 0, "levels");
+    CHECK(thumbnail.level(1, 0) == Thumbnail::MAX_LEVEL, "levels");
+    CHECK(thumbnail.level(2, 0) == Thumbnail::MAX_LEVEL, "partial block");
+    CHECK(thumbnail.level(2, 1) == Thumbnail::MAX_LEVEL, "partial block");
+
+    Bitplane expected(3, 2);
+    expected.fillRange(0, 1, 3);
+    expected.fillRange(1, 1, 3);
+    CHECK(Check::samePixels(thumbnail.toBitplane(), expected), "levels");
+
+    string art;
+    thumbnail.renderTo(art);
+    CHECK(art == ".@@\n @@\n", "levels");
+}
+
+void checkScale()
+{
+    Bitplane pixels(3, 2);
+    pixels.set(0, 0, true);
+    pixels.set(2, 1, true);
+    const SimpleIcon icon("Scaled", 1, pixels);
+    const string header = "Scaled(3x2)\nVersion: 1\n";
+
+    string frame;
+    CHECK(icon.renderTo(frame) && frame == header + "x  \n  x\n", "scale 1");
+    CHECK(icon.renderTo(frame, 2) && frame == header + "xx    \nxx    \n    xx\n    xx\n",
+          "scale 2");
+    for (int scale : { 0, -1, INT_MIN, INT_MAX, 1 << 30 }) {
+        frame = "stale";
+        CHECK(!icon.renderTo(frame, scale) && frame.empty(), "scale " + std::to_string(scale));
+    }
+}
+
+}
+
+void checkThumbnail()
+{
+    const PixelDecoder::Isa previous = PixelDecoder::isa();
+    const int widths[] = { 1, 7, 8, 9, 63, 64, 65, 130, 201 };
+    std::mt19937 random(13);
+
+    for (int isa = PixelDecoder::SCALAR; isa <= PixelDecoder::detectedIsa(); ++isa) {
+        PixelDecoder::setIsa(PixelDecoder::Isa(isa));
+        for (int width : widths) {
+            checkImage(PixelDecoder::Isa(isa), width, 1 + int(random() % 90), random);
+        }
+    }
+    PixelDecoder::setIsa(previous);
+
+    checkLevels();
+    checkScale();
+}